@@ -0,0 +1,395 @@
+//Available under GPLv3.
+//Author: Iouri Khramtsov.
+
+//Native game engine.  Plays whole games in-process following the rules
+//of tools/PlayGame.jar, but drives the players directly instead of
+//spawning them as separate processes and talking to them over pipes.
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "Actions.h"
+#include "Bot.h"
+#include "Engine.h"
+#include "GameTimeline.h"
+#include "Timer.h"
+
+/************************************************
+               BotPlayer class
+************************************************/
+BotPlayer::BotPlayer()
+: bot_(NULL) {
+}
+
+BotPlayer::~BotPlayer() {
+    delete bot_;
+}
+
+void BotPlayer::DoTurn(GameMap* game_map, MoveOrderList& orders) {
+    if (game_map->Turn() == 1) {
+        delete bot_;
+        bot_ = new Bot();
+        bot_->SetGame(game_map);
+    }
+
+    ActionList actions = bot_->MakeMoves();
+
+    //Only the actions departing now are sent to the engine.  See Action::ToMoveOrder().
+    for (uint i = 0; i < actions.size(); ++i) {
+        Action* action = actions[i];
+
+        if (0 == action->DepartureTime()) {
+            MoveOrder order;
+            order.source = action->Source()->Id();
+            order.destination = action->Target()->Id();
+            order.num_ships = action->NumShips();
+            orders.push_back(order);
+        }
+    }
+
+    Action::FreeActions(actions);
+}
+
+/************************************************
+               GameResult class
+************************************************/
+GameResult::GameResult()
+: winner(0),
+num_turns(0),
+dropped_player(0) {
+}
+
+/************************************************
+               GameEngine class
+************************************************/
+GameEngine::GameEngine()
+: map_(NULL),
+turn_(0),
+max_turns_(kDefaultMaxTurns),
+is_verbose_(false) {
+}
+
+GameEngine::~GameEngine() {
+    delete map_;
+}
+
+int GameEngine::LoadMap(const std::string& map_file) {
+    std::ifstream file(map_file.c_str());
+
+    if (!file) {
+        return 0;
+    }
+
+    std::stringstream map_data;
+    map_data << file.rdbuf();
+    return this->LoadMapData(map_data.str());
+}
+
+int GameEngine::LoadMapData(const std::string& map_data) {
+    delete map_;
+    map_ = new GameMap();
+    fleets_.clear();
+    turn_ = 0;
+
+    if (0 == map_->Initialize(map_data) || 0 == map_->NumPlanets()) {
+        return 0;
+    }
+
+    //Maps may start with fleets in flight.
+    FleetList fleets = map_->Fleets();
+
+    for (uint i = 0; i < fleets.size(); ++i) {
+        fleets_.push_back(*fleets[i]);
+    }
+
+    return 1;
+}
+
+GameResult GameEngine::Play(EnginePlayer* player1, EnginePlayer* player2) {
+    pw_assert(NULL != map_ && "The map must be loaded before playing.");
+
+    EnginePlayer* players[2] = {player1, player2};
+    GameMap* player_maps[2] = {new GameMap(), new GameMap()};
+    MoveOrderList orders[2];
+    GameResult result;
+    std::string state;
+
+    while (this->Winner() < 0) {
+        //Both players see the same state; orders are issued only after
+        //both players have made their moves.
+        for (int i = 0; i < 2; ++i) {
+            const int player = i + 1;
+            orders[i].clear();
+
+            if (!this->IsAlive(player)) {
+                continue;
+            }
+
+            this->WriteStateFor(player, state);
+
+            if (0 == turn_) {
+                player_maps[i]->Initialize(state);
+            } else {
+                player_maps[i]->Update(state);
+            }
+
+            SetTimeOut(0 == turn_ ? 2.95 : 0.95);
+            players[i]->DoTurn(player_maps[i], orders[i]);
+            result.turn_millis[player].push_back(MillisElapsed());
+        }
+
+        for (int i = 0; i < 2; ++i) {
+            const int player = i + 1;
+
+            if (is_verbose_) {
+                for (uint j = 0; j < orders[i].size(); ++j) {
+                    std::cout << "Turn " << (turn_ + 1) << ", player " << player << ": "
+                        << orders[i][j].source << " " << orders[i][j].destination << " "
+                        << orders[i][j].num_ships << std::endl;
+                }
+            }
+
+            if (!this->IssueOrders(player, orders[i])) {
+                this->DropPlayer(player);
+                result.dropped_player = player;
+            }
+        }
+
+        this->DoTimeStep();
+    }
+
+    result.winner = this->Winner();
+    result.num_turns = turn_;
+
+    delete player_maps[0];
+    delete player_maps[1];
+
+    return result;
+}
+
+int GameEngine::Winner() const {
+    const bool is_player1_alive = this->IsAlive(kMe);
+    const bool is_player2_alive = this->IsAlive(kEnemy);
+
+    if (!is_player1_alive || !is_player2_alive) {
+        if (is_player1_alive) {
+            return kMe;
+        } else if (is_player2_alive) {
+            return kEnemy;
+        } else {
+            return 0;
+        }
+    }
+
+    if (turn_ > max_turns_) {
+        //Out of time.  The player with more ships wins.
+        const int player1_ships = this->NumShips(kMe);
+        const int player2_ships = this->NumShips(kEnemy);
+
+        if (player1_ships > player2_ships) {
+            return kMe;
+        } else if (player1_ships < player2_ships) {
+            return kEnemy;
+        } else {
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+void GameEngine::WriteStateFor(const int player, std::string& state) const {
+    //Each player sees itself as player 1.
+    std::stringstream s;
+    s.precision(17);
+
+    const int num_planets = map_->NumPlanets();
+
+    for (int i = 0; i < num_planets; ++i) {
+        Planet* p = map_->GetPlanet(i);
+        const int owner = (kEnemy == player && kNeutral != p->Owner() ? OtherPlayer(p->Owner()) : p->Owner());
+        s << "P " << p->X() << " " << p->Y() << " " << owner
+          << " " << p->NumShips() << " " << p->GrowthRate() << "\n";
+    }
+
+    for (uint i = 0; i < fleets_.size(); ++i) {
+        const Fleet& f = fleets_[i];
+        const int owner = (kEnemy == player ? OtherPlayer(f.Owner()) : f.Owner());
+        s << "F " << owner << " " << f.NumShips() << " "
+          << f.Source()->Id() << " " << f.Destination()->Id() << " "
+          << f.TripLength() << " " << f.TurnsRemaining() << "\n";
+    }
+
+    state = s.str();
+}
+
+bool GameEngine::IssueOrders(const int player, const MoveOrderList& orders) {
+    const int num_planets = map_->NumPlanets();
+
+    //Check all of the orders before applying any, so that a dropped player
+    //sends no fleets at all.
+    std::vector<int> ships_left(num_planets, 0);
+
+    for (int i = 0; i < num_planets; ++i) {
+        ships_left[i] = map_->GetPlanet(i)->NumShips();
+    }
+
+    for (uint i = 0; i < orders.size(); ++i) {
+        const MoveOrder& order = orders[i];
+
+        if (order.source < 0 || order.source >= num_planets
+            || order.destination < 0 || order.destination >= num_planets) {
+            return false;
+        }
+
+        Planet* source = map_->GetPlanet(order.source);
+
+        if (source->Owner() != player || order.num_ships > ships_left[order.source] || order.num_ships < 0) {
+            return false;
+        }
+
+        ships_left[order.source] -= order.num_ships;
+    }
+
+    for (uint i = 0; i < orders.size(); ++i) {
+        const MoveOrder& order = orders[i];
+        Planet* source = map_->GetPlanet(order.source);
+        source->RemoveShips(order.num_ships);
+
+        const int distance = map_->GetDistance(order.source, order.destination);
+        fleets_.push_back(Fleet(player, order.num_ships, source,
+            map_->GetPlanet(order.destination), distance, distance));
+    }
+
+    return true;
+}
+
+void GameEngine::DropPlayer(const int player) {
+    const int num_planets = map_->NumPlanets();
+
+    for (int i = 0; i < num_planets; ++i) {
+        Planet* planet = map_->GetPlanet(i);
+
+        if (planet->Owner() == player) {
+            planet->Owner(kNeutral);
+        }
+    }
+
+    uint num_remaining_fleets = 0;
+
+    for (uint i = 0; i < fleets_.size(); ++i) {
+        if (fleets_[i].Owner() != player) {
+            fleets_[num_remaining_fleets++] = fleets_[i];
+        }
+    }
+
+    fleets_.resize(num_remaining_fleets, Fleet());
+}
+
+void GameEngine::DoTimeStep() {
+    const int num_planets = map_->NumPlanets();
+
+    //Grow the ships on the owned planets.
+    for (int i = 0; i < num_planets; ++i) {
+        Planet* planet = map_->GetPlanet(i);
+
+        if (kNeutral != planet->Owner()) {
+            planet->AddShips(planet->GrowthRate());
+        }
+    }
+
+    //Advance the fleets.
+    for (uint i = 0; i < fleets_.size(); ++i) {
+        Fleet& fleet = fleets_[i];
+        fleet.SetTurnsRemaining(std::max(fleet.TurnsRemaining() - 1, 0));
+    }
+
+    //Fight the battles.
+    for (int i = 0; i < num_planets; ++i) {
+        this->FightBattle(map_->GetPlanet(i));
+    }
+
+    ++turn_;
+}
+
+void GameEngine::FightBattle(Planet* planet) {
+    int my_arrivals = 0;
+    int enemy_arrivals = 0;
+    bool has_arrivals = false;
+    uint num_remaining_fleets = 0;
+
+    //Collect the arriving fleets; keep the rest.
+    for (uint i = 0; i < fleets_.size(); ++i) {
+        const Fleet& fleet = fleets_[i];
+
+        if (fleet.Destination() == planet && 0 == fleet.TurnsRemaining()) {
+            has_arrivals = true;
+
+            if (kMe == fleet.Owner()) {
+                my_arrivals += fleet.NumShips();
+            } else {
+                enemy_arrivals += fleet.NumShips();
+            }
+
+        } else {
+            fleets_[num_remaining_fleets++] = fleet;
+        }
+    }
+
+    fleets_.resize(num_remaining_fleets, Fleet());
+
+    if (!has_arrivals) {
+        return;
+    }
+
+    const int owner = planet->Owner();
+    const int ships = planet->NumShips();
+    const int neutral_ships = (kNeutral == owner ? ships : 0);
+    const int my_ships = my_arrivals + (kMe == owner ? ships : 0);
+    const int enemy_ships = enemy_arrivals + (kEnemy == owner ? ships : 0);
+
+    BattleOutcome outcome = ResolveBattle(owner, neutral_ships, my_ships, enemy_ships);
+    planet->Owner(outcome.owner);
+    planet->NumShips(outcome.ships_remaining);
+}
+
+bool GameEngine::IsAlive(const int player) const {
+    const int num_planets = map_->NumPlanets();
+
+    for (int i = 0; i < num_planets; ++i) {
+        if (map_->GetPlanet(i)->Owner() == player) {
+            return true;
+        }
+    }
+
+    for (uint i = 0; i < fleets_.size(); ++i) {
+        if (fleets_[i].Owner() == player) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int GameEngine::NumShips(const int player) const {
+    const int num_planets = map_->NumPlanets();
+    int num_ships = 0;
+
+    for (int i = 0; i < num_planets; ++i) {
+        Planet* planet = map_->GetPlanet(i);
+
+        if (planet->Owner() == player) {
+            num_ships += planet->NumShips();
+        }
+    }
+
+    for (uint i = 0; i < fleets_.size(); ++i) {
+        if (fleets_[i].Owner() == player) {
+            num_ships += fleets_[i].NumShips();
+        }
+    }
+
+    return num_ships;
+}
@@ -0,0 +1,113 @@
+//Available under GPLv3.
+//Author: Iouri Khramtsov.
+
+//Native game engine.  Plays whole games in-process following the rules
+//of tools/PlayGame.jar, but drives the players directly instead of
+//spawning them as separate processes and talking to them over pipes.
+
+#ifndef PLANET_WARS_ENGINE_H_
+#define PLANET_WARS_ENGINE_H_
+
+#include <string>
+#include <vector>
+#include "PlanetWars.h"
+#include "Utils.h"
+
+class Bot;
+class EnginePlayer;
+class GameResult;
+
+//An order to send ships, as it would be written to the game engine.
+class MoveOrder {
+public:
+    int source;
+    int destination;
+    int num_ships;
+};
+
+typedef std::vector<MoveOrder> MoveOrderList;
+
+//A participant in a game.  The engine calls DoTurn() once per turn with
+//the game state as seen by the player, i.e. the player is always kMe.
+class EnginePlayer {
+public:
+    virtual ~EnginePlayer() {}
+
+    virtual std::string Name() const = 0;
+    virtual void DoTurn(GameMap* game_map, MoveOrderList& orders) = 0;
+};
+
+//Plays the bot from Bot.cc.  Mirrors what DoTurn() in MyBot.cc does.
+class BotPlayer : public EnginePlayer {
+public:
+    BotPlayer();
+    ~BotPlayer();
+
+    std::string Name() const                    {return "MyBot";}
+    void DoTurn(GameMap* game_map, MoveOrderList& orders);
+
+private:
+    Bot* bot_;
+};
+
+//Outcome of a single game.
+class GameResult {
+public:
+    GameResult();
+
+    int winner;             //kMe or kEnemy for player 1 or 2; 0 for a draw.
+    int num_turns;
+    int dropped_player;     //Player kicked out for issuing an invalid order; 0 if none.
+
+    //Time taken by each player to make its moves, one entry per turn,
+    //in milliseconds.  Indexed by player.
+    std::vector<int> turn_millis[3];
+};
+
+class GameEngine {
+public:
+    static const int kDefaultMaxTurns = 200;
+
+    GameEngine();
+    ~GameEngine();
+
+    //Load the starting state of the game.  Return 1 on success, 0 on failure.
+    int LoadMap(const std::string& map_file);
+    int LoadMapData(const std::string& map_data);
+
+    void SetMaxTurns(int max_turns)             {max_turns_ = max_turns;}
+    void SetVerbose(bool verbose)               {is_verbose_ = verbose;}
+
+    //Play the game to the end.  Players are numbered 1 and 2 in the
+    //order they are passed in.
+    GameResult Play(EnginePlayer* player1, EnginePlayer* player2);
+
+    //Find the winner: 1 or 2 if the game is over and won, 0 if it's
+    //a draw, -1 if the game is not over yet.
+    int Winner() const;
+
+private:
+    //Write the game state as seen by the player, in the format accepted
+    //by GameMap::Initialize() and GameMap::Update().
+    void WriteStateFor(int player, std::string& state) const;
+
+    //Apply a player's orders.  If any of the orders is invalid, apply none of
+    //them and return false.
+    bool IssueOrders(int player, const MoveOrderList& orders);
+    void DropPlayer(int player);
+
+    //Grow the planets, advance the fleets and fight the battles.
+    void DoTimeStep();
+    void FightBattle(Planet* planet);
+
+    bool IsAlive(int player) const;
+    int NumShips(int player) const;
+
+    GameMap* map_;          //Authoritative game state.
+    std::vector<Fleet> fleets_;
+    int turn_;
+    int max_turns_;
+    bool is_verbose_;
+};
+
+#endif
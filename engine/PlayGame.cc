@@ -0,0 +1,116 @@
+//Available under GPLv3.
+//Author: Iouri Khramtsov.
+
+//Plays two players against each other (MyBot against itself by default)
+//on one or more maps using the native game engine.  A faster substitute
+//for tools/PlayGame.jar in regression runs.
+//
+//Usage: PlayGame [-v] [-n] [-t max_turns] [-s search_threads] [-1 player] [-2 player] map_file [map_file ...]
+//
+//-n turns off MyBot's pruning by return bound.  It should not change any moves.
+
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Bot.h"
+#include "Engine.h"
+#include "Players.h"
+
+int main(int argc, char *argv[]) {
+    std::vector<std::string> map_files;
+    int max_turns = GameEngine::kDefaultMaxTurns;
+    bool is_verbose = false;
+    std::string player_names[2] = {"MyBot", "MyBot"};
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+
+        if ("-v" == arg) {
+            is_verbose = true;
+
+        } else if ("-n" == arg) {
+            Bot::SetReturnBoundPruning(false);
+
+        } else if ("-t" == arg && i + 1 < argc) {
+            max_turns = atoi(argv[++i]);
+
+        } else if ("-s" == arg && i + 1 < argc) {
+            Bot::SetNumSearchThreads(atoi(argv[++i]));
+
+        } else if (("-1" == arg || "-2" == arg) && i + 1 < argc) {
+            player_names["-1" == arg ? 0 : 1] = argv[++i];
+
+        } else {
+            map_files.push_back(arg);
+        }
+    }
+
+    if (map_files.empty()) {
+        std::cerr << "Usage: PlayGame [-v] [-n] [-t max_turns] [-s search_threads] [-1 player] [-2 player] "
+            << "map_file [map_file ...]" << std::endl;
+        return 1;
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        EnginePlayer* player = CreatePlayer(player_names[i]);
+
+        if (NULL == player) {
+            std::cerr << "Unknown player: " << player_names[i] << std::endl;
+            return 1;
+        }
+
+        delete player;
+    }
+
+    int wins[3] = {0, 0, 0};
+    const clock_t start_time = clock();
+
+    for (uint i = 0; i < map_files.size(); ++i) {
+        GameEngine engine;
+        engine.SetMaxTurns(max_turns);
+        engine.SetVerbose(is_verbose);
+
+        if (0 == engine.LoadMap(map_files[i])) {
+            std::cerr << "Could not load " << map_files[i] << std::endl;
+            return 1;
+        }
+
+        EnginePlayer* player1 = CreatePlayer(player_names[0]);
+        EnginePlayer* player2 = CreatePlayer(player_names[1]);
+        const clock_t game_start_time = clock();
+        GameResult result = engine.Play(player1, player2);
+        const clock_t game_end_time = clock();
+
+        delete player1;
+        delete player2;
+
+        wins[result.winner]++;
+
+        std::cout << map_files[i] << ": ";
+
+        if (0 == result.winner) {
+            std::cout << "Draw";
+        } else {
+            std::cout << "Player " << result.winner << " wins";
+        }
+
+        std::cout << " in " << result.num_turns << " turns";
+
+        if (0 != result.dropped_player) {
+            std::cout << " (player " << result.dropped_player << " issued an invalid order)";
+        }
+
+        std::cout << ", " << (game_end_time - game_start_time) * 1000 / CLOCKS_PER_SEC << "ms" << std::endl;
+    }
+
+    const clock_t end_time = clock();
+
+    std::cout << "Player 1: " << wins[kMe] << ", Player 2: " << wins[kEnemy]
+        << ", Draws: " << wins[0] << ", Total time: "
+        << (end_time - start_time) * 1000 / CLOCKS_PER_SEC << "ms" << std::endl;
+
+    return 0;
+}
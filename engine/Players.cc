@@ -0,0 +1,245 @@
+//Available under GPLv3.
+//Author: Iouri Khramtsov.
+
+//Opponents for the native engine: ports of the sample bots from
+//example_bots\, and a factory that creates any known player by name.
+
+#include <limits>
+
+#include "Players.h"
+
+namespace {
+
+void AddOrder(Planet* source, Planet* destination, int num_ships, MoveOrderList& orders) {
+    MoveOrder order;
+    order.source = source->Id();
+    order.destination = destination->Id();
+    order.num_ships = num_ships;
+    orders.push_back(order);
+}
+
+//Find the player's planet with the highest (ships / (1 + growth rate)).
+//This is the source used by ProspectorBot and DualBot.
+Planet* StrongestPlanet(GameMap* game_map) {
+    PlanetList planets = game_map->MyPlanets();
+    Planet* source = NULL;
+    double source_score = std::numeric_limits<double>::min();
+
+    for (uint i = 0; i < planets.size(); ++i) {
+        Planet* p = planets[i];
+        const double score = static_cast<double>(p->NumShips()) / (1 + p->GrowthRate());
+
+        if (score > source_score) {
+            source_score = score;
+            source = p;
+        }
+    }
+
+    return source;
+}
+
+//Find the planet with the highest ((1 + growth rate) / ships).
+Planet* WeakestPlanet(const PlanetList& candidates) {
+    Planet* destination = NULL;
+    double destination_score = std::numeric_limits<double>::min();
+
+    for (uint i = 0; i < candidates.size(); ++i) {
+        Planet* p = candidates[i];
+        const double score = static_cast<double>(1 + p->GrowthRate()) / p->NumShips();
+
+        if (score > destination_score) {
+            destination_score = score;
+            destination = p;
+        }
+    }
+
+    return destination;
+}
+
+} //namespace
+
+/************************************************
+               BullyBot class
+************************************************/
+void BullyBot::DoTurn(GameMap* game_map, MoveOrderList& orders) {
+    if (!game_map->MyFleets().empty()) {
+        return;
+    }
+
+    //Attack the planet with the fewest ships from the planet with the most ships.
+    PlanetList my_planets = game_map->MyPlanets();
+    Planet* source = NULL;
+    double source_score = std::numeric_limits<double>::min();
+
+    for (uint i = 0; i < my_planets.size(); ++i) {
+        const double score = static_cast<double>(my_planets[i]->NumShips());
+
+        if (score > source_score) {
+            source_score = score;
+            source = my_planets[i];
+        }
+    }
+
+    PlanetList targets = game_map->NotMyPlanets();
+    Planet* destination = NULL;
+    double destination_score = std::numeric_limits<double>::min();
+
+    for (uint i = 0; i < targets.size(); ++i) {
+        const double score = 1.0 / (1 + targets[i]->NumShips());
+
+        if (score > destination_score) {
+            destination_score = score;
+            destination = targets[i];
+        }
+    }
+
+    if (NULL != source && NULL != destination) {
+        AddOrder(source, destination, source->NumShips() / 2, orders);
+    }
+}
+
+/************************************************
+               DualBot class
+************************************************/
+void DualBot::DoTurn(GameMap* game_map, MoveOrderList& orders) {
+    //Keep more fleets in flight when behind.
+    uint num_fleets = 1;
+    bool is_attack_mode = false;
+    const bool has_more_ships = game_map->NumShips(kMe) > game_map->NumShips(kEnemy);
+    const bool has_more_growth = game_map->GrowthRate(kMe) > game_map->GrowthRate(kEnemy);
+
+    if (has_more_ships) {
+        if (has_more_growth) {
+            num_fleets = 1;
+            is_attack_mode = true;
+        } else {
+            num_fleets = 3;
+        }
+
+    } else {
+        num_fleets = (has_more_growth ? 1 : 5);
+    }
+
+    if (game_map->MyFleets().size() >= num_fleets) {
+        return;
+    }
+
+    Planet* source = StrongestPlanet(game_map);
+    Planet* destination =
+        WeakestPlanet(is_attack_mode ? game_map->EnemyPlanets() : game_map->NotMyPlanets());
+
+    if (NULL != source && NULL != destination) {
+        AddOrder(source, destination, source->NumShips() / 2, orders);
+    }
+}
+
+/************************************************
+               ProspectorBot class
+************************************************/
+void ProspectorBot::DoTurn(GameMap* game_map, MoveOrderList& orders) {
+    if (!game_map->MyFleets().empty()) {
+        return;
+    }
+
+    Planet* source = StrongestPlanet(game_map);
+    Planet* destination = WeakestPlanet(game_map->NotMyPlanets());
+
+    if (NULL != source && NULL != destination) {
+        AddOrder(source, destination, source->NumShips() / 2, orders);
+    }
+}
+
+/************************************************
+               RageBot class
+************************************************/
+void RageBot::DoTurn(GameMap* game_map, MoveOrderList& orders) {
+    //Send everything from the well-stocked planets to the closest enemy planet.
+    PlanetList my_planets = game_map->MyPlanets();
+    PlanetList enemy_planets = game_map->EnemyPlanets();
+
+    for (uint i = 0; i < my_planets.size(); ++i) {
+        Planet* source = my_planets[i];
+
+        if (source->NumShips() < 10 * source->GrowthRate()) {
+            continue;
+        }
+
+        Planet* destination = NULL;
+        int best_distance = 999999;
+
+        for (uint j = 0; j < enemy_planets.size(); ++j) {
+            const int distance = game_map->GetDistance(source, enemy_planets[j]);
+
+            if (distance < best_distance) {
+                best_distance = distance;
+                destination = enemy_planets[j];
+            }
+        }
+
+        if (NULL != destination) {
+            AddOrder(source, destination, source->NumShips(), orders);
+        }
+    }
+}
+
+/************************************************
+               RandomBot class
+************************************************/
+RandomBot::RandomBot()
+: seed_(12345) {
+}
+
+void RandomBot::DoTurn(GameMap* game_map, MoveOrderList& orders) {
+    if (!game_map->MyFleets().empty()) {
+        return;
+    }
+
+    PlanetList my_planets = game_map->MyPlanets();
+    PlanetList planets = game_map->Planets();
+
+    if (my_planets.empty() || planets.empty()) {
+        return;
+    }
+
+    Planet* source = my_planets[this->NextRandom(my_planets.size())];
+    Planet* destination = planets[this->NextRandom(planets.size())];
+    AddOrder(source, destination, source->NumShips() / 2, orders);
+}
+
+int RandomBot::NextRandom(const int range) {
+    //A linear congruential generator; rand() would be shared between threads.
+    seed_ = seed_ * 1103515245 + 12345;
+    return static_cast<int>((seed_ >> 16) % static_cast<unsigned int>(range));
+}
+
+/************************************************
+               Player factory
+************************************************/
+EnginePlayer* CreatePlayer(const std::string& name) {
+    if ("MyBot" == name) {
+        return new BotPlayer();
+    } else if ("BullyBot" == name) {
+        return new BullyBot();
+    } else if ("DualBot" == name) {
+        return new DualBot();
+    } else if ("ProspectorBot" == name) {
+        return new ProspectorBot();
+    } else if ("RageBot" == name) {
+        return new RageBot();
+    } else if ("RandomBot" == name) {
+        return new RandomBot();
+    }
+
+    return NULL;
+}
+
+std::vector<std::string> PlayerNames() {
+    std::vector<std::string> names;
+    names.push_back("MyBot");
+    names.push_back("BullyBot");
+    names.push_back("DualBot");
+    names.push_back("ProspectorBot");
+    names.push_back("RageBot");
+    names.push_back("RandomBot");
+    return names;
+}
@@ -0,0 +1,59 @@
+//Available under GPLv3.
+//Author: Iouri Khramtsov.
+
+//Opponents for the native engine: ports of the sample bots from
+//example_bots\, and a factory that creates any known player by name.
+
+#ifndef PLANET_WARS_PLAYERS_H_
+#define PLANET_WARS_PLAYERS_H_
+
+#include <string>
+#include <vector>
+#include "Engine.h"
+
+class BullyBot : public EnginePlayer {
+public:
+    std::string Name() const                    {return "BullyBot";}
+    void DoTurn(GameMap* game_map, MoveOrderList& orders);
+};
+
+class DualBot : public EnginePlayer {
+public:
+    std::string Name() const                    {return "DualBot";}
+    void DoTurn(GameMap* game_map, MoveOrderList& orders);
+};
+
+class ProspectorBot : public EnginePlayer {
+public:
+    std::string Name() const                    {return "ProspectorBot";}
+    void DoTurn(GameMap* game_map, MoveOrderList& orders);
+};
+
+class RageBot : public EnginePlayer {
+public:
+    std::string Name() const                    {return "RageBot";}
+    void DoTurn(GameMap* game_map, MoveOrderList& orders);
+};
+
+//Unlike the Java version, picks planets with a fixed-seed generator so
+//that games can be replayed.
+class RandomBot : public EnginePlayer {
+public:
+    RandomBot();
+
+    std::string Name() const                    {return "RandomBot";}
+    void DoTurn(GameMap* game_map, MoveOrderList& orders);
+
+private:
+    int NextRandom(int range);
+
+    unsigned int seed_;
+};
+
+//Create a player by name.  Return NULL if the name is unknown.
+EnginePlayer* CreatePlayer(const std::string& name);
+
+//Names of all the players that CreatePlayer() knows about.
+std::vector<std::string> PlayerNames();
+
+#endif
@@ -0,0 +1,233 @@
+//Available under GPLv3.
+//Author: Iouri Khramtsov.
+
+//Plays MyBot against a set of opponents on a set of maps, from both sides,
+//spreading the games across all cores.  Every game is played start to
+//finish by one worker thread, so each game's GameMap, GameTimeline and
+//ActionPool belong to that thread alone.
+//
+//Usage: Tournament [-j num_threads] [-t max_turns] [-o opponent ...] map_file [map_file ...]
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Bot.h"
+#include "Engine.h"
+#include "Players.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+//One game: MyBot against an opponent on a map, with MyBot playing as a given side.
+class GameTask : public Task {
+public:
+    GameTask(const std::string& map_file, const std::string& opponent, int side, int max_turns)
+    : map_file_(map_file), opponent_(opponent), side_(side), max_turns_(max_turns), is_loaded_(false) {
+    }
+
+    void Run(int /*worker_id*/) {
+        GameEngine engine;
+        engine.SetMaxTurns(max_turns_);
+        is_loaded_ = (0 != engine.LoadMap(map_file_));
+
+        if (!is_loaded_) {
+            return;
+        }
+
+        EnginePlayer* my_bot = CreatePlayer("MyBot");
+        EnginePlayer* opponent = CreatePlayer(opponent_);
+
+        if (kMe == side_) {
+            result_ = engine.Play(my_bot, opponent);
+        } else {
+            result_ = engine.Play(opponent, my_bot);
+        }
+
+        delete my_bot;
+        delete opponent;
+    }
+
+    const std::string& MapFile() const      {return map_file_;}
+    const std::string& Opponent() const     {return opponent_;}
+    int Side() const                        {return side_;}
+    bool IsLoaded() const                   {return is_loaded_;}
+    const GameResult& Result() const        {return result_;}
+
+private:
+    std::string map_file_;
+    std::string opponent_;
+    int side_;
+    int max_turns_;
+    bool is_loaded_;
+    GameResult result_;
+};
+
+//Win/loss/draw tally from MyBot's point of view.
+class Score {
+public:
+    Score() : wins(0), losses(0), draws(0), invalid_orders(0) {}
+
+    int wins;
+    int losses;
+    int draws;
+    int invalid_orders;
+};
+
+int Percentile(const std::vector<int>& sorted_values, const int percentile) {
+    if (sorted_values.empty()) {
+        return 0;
+    }
+
+    const uint index = (sorted_values.size() - 1) * percentile / 100;
+    return sorted_values[index];
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<std::string> map_files;
+    std::vector<std::string> opponents;
+    int num_threads = 0;
+    int max_turns = GameEngine::kDefaultMaxTurns;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+
+        if ("-j" == arg && i + 1 < argc) {
+            num_threads = atoi(argv[++i]);
+
+        } else if ("-t" == arg && i + 1 < argc) {
+            max_turns = atoi(argv[++i]);
+
+        } else if ("-o" == arg && i + 1 < argc) {
+            opponents.push_back(argv[++i]);
+
+        } else {
+            map_files.push_back(arg);
+        }
+    }
+
+    if (map_files.empty()) {
+        std::cerr << "Usage: Tournament [-j num_threads] [-t max_turns] [-o opponent ...] "
+            << "map_file [map_file ...]" << std::endl;
+        return 1;
+    }
+
+    if (opponents.empty()) {
+        opponents = PlayerNames();
+    }
+
+    for (uint i = 0; i < opponents.size(); ++i) {
+        EnginePlayer* player = CreatePlayer(opponents[i]);
+
+        if (NULL == player) {
+            std::cerr << "Unknown opponent: " << opponents[i] << std::endl;
+            return 1;
+        }
+
+        delete player;
+    }
+
+    //Queue up all the games.  The games already keep every core busy, so
+    //each bot searches on its own thread.
+    SetTimeOut(0);
+    Bot::SetNumSearchThreads(1);
+    std::vector<GameTask*> tasks;
+    ThreadPool pool(num_threads);
+
+    for (uint m = 0; m < map_files.size(); ++m) {
+        for (uint o = 0; o < opponents.size(); ++o) {
+            for (int side = kMe; side <= kEnemy; ++side) {
+                GameTask* task = new GameTask(map_files[m], opponents[o], side, max_turns);
+                tasks.push_back(task);
+                pool.Submit(task);
+            }
+        }
+    }
+
+    pool.Wait();
+    const int millis_elapsed = MillisElapsed();
+
+    //Tally up the results.
+    std::vector<Score> scores(opponents.size());
+    Score total_score;
+    std::vector<int> turn_millis;
+
+    for (uint i = 0; i < tasks.size(); ++i) {
+        GameTask* task = tasks[i];
+
+        if (!task->IsLoaded()) {
+            std::cerr << "Could not load " << task->MapFile() << std::endl;
+            continue;
+        }
+
+        const GameResult& result = task->Result();
+        const int side = task->Side();
+        const uint opponent_index =
+            std::find(opponents.begin(), opponents.end(), task->Opponent()) - opponents.begin();
+        Score& score = scores[opponent_index];
+
+        if (side == result.winner) {
+            score.wins++;
+            total_score.wins++;
+
+        } else if (0 == result.winner) {
+            score.draws++;
+            total_score.draws++;
+
+        } else {
+            score.losses++;
+            total_score.losses++;
+            std::cout << "Lost to " << task->Opponent() << " on " << task->MapFile()
+                << " as player " << side << std::endl;
+        }
+
+        if (side == result.dropped_player) {
+            score.invalid_orders++;
+            total_score.invalid_orders++;
+        }
+
+        const std::vector<int>& game_turn_millis = result.turn_millis[side];
+        turn_millis.insert(turn_millis.end(), game_turn_millis.begin(), game_turn_millis.end());
+    }
+
+    std::cout << std::endl << std::left << std::setw(16) << "Opponent" << std::right
+        << std::setw(8) << "Wins" << std::setw(8) << "Losses"
+        << std::setw(8) << "Draws" << std::setw(10) << "Invalid" << std::endl;
+
+    for (uint i = 0; i <= opponents.size(); ++i) {
+        const Score& score = (i < opponents.size() ? scores[i] : total_score);
+        const std::string name = (i < opponents.size() ? opponents[i] : "Total");
+
+        std::cout << std::left << std::setw(16) << name << std::right
+            << std::setw(8) << score.wins << std::setw(8) << score.losses
+            << std::setw(8) << score.draws << std::setw(10) << score.invalid_orders << std::endl;
+    }
+
+    //Per-turn latency of MyBot.
+    std::sort(turn_millis.begin(), turn_millis.end());
+    double total_millis = 0;
+
+    for (uint i = 0; i < turn_millis.size(); ++i) {
+        total_millis += turn_millis[i];
+    }
+
+    const double mean_millis = (turn_millis.empty() ? 0 : total_millis / turn_millis.size());
+
+    std::cout << std::endl << "MyBot turn time over " << turn_millis.size() << " turns: "
+        << "mean " << std::fixed << std::setprecision(2) << mean_millis << "ms"
+        << ", median " << Percentile(turn_millis, 50) << "ms"
+        << ", 95th " << Percentile(turn_millis, 95) << "ms"
+        << ", 99th " << Percentile(turn_millis, 99) << "ms"
+        << ", max " << (turn_millis.empty() ? 0 : turn_millis.back()) << "ms" << std::endl;
+
+    std::cout << "Played " << tasks.size() << " games on " << pool.NumWorkers()
+        << " threads in " << millis_elapsed << "ms" << std::endl;
+
+    for (uint i = 0; i < tasks.size(); ++i) {
+        delete tasks[i];
+    }
+
+    return (0 == total_score.invalid_orders ? 0 : 1);
+}
@@ -14,7 +14,7 @@
 /************************************************
                Action class
 ************************************************/
-ActionPool* Action::s_pool_ = NULL;
+pw_thread_local ActionPool* Action::s_pool_ = NULL;
 
 Action::Action()
 :is_contingent_(false) {
@@ -103,6 +103,10 @@ ActionPool::~ActionPool() {
     for (uint i = 0; i < free_actions_.size(); ++i) {
         delete free_actions_[i];
     }
+
+    if (Action::s_pool_ == this) {
+        Action::SetActionPool(NULL);
+    }
 }
 
 void ActionPool::FreeAction(Action *action) {
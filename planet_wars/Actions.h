@@ -10,6 +10,7 @@
 
 #include <string>
 #include <vector>
+#include "Utils.h"
 
 class Action;
 class ActionPool;
@@ -61,7 +62,8 @@ private:
 
     static void SetActionPool(ActionPool* p)        {s_pool_ = p;}
 
-    static ActionPool* s_pool_;
+    //Each thread has its own pool.
+    static pw_thread_local ActionPool* s_pool_;
 
     int owner_;
     PlanetTimeline* source_;
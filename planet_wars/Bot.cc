@@ -6,6 +6,19 @@
 #include "Bot.h"
 #include "GameTimeline.h"
 #include "Timer.h"
+#include <algorithm>
+
+#ifdef WITH_PARALLEL_SEARCH
+#include "ThreadPool.h"
+#endif
+
+#ifdef WITH_WATCHDOG
+#include "Watchdog.h"
+#endif
+
+#ifdef WITH_PONDERING
+#include "Ponderer.h"
+#endif
 
 #ifndef IS_SUBMISSION
 #include <iostream>
@@ -17,14 +30,34 @@
 ************************************************/
 const double Bot::kAggressionReturnMultiplier = 3;
 
+int Bot::s_num_search_threads_ = 0;
+bool Bot::s_is_return_bound_pruning_ = true;
+
 Bot::Bot() 
 : game_(NULL),
 timeline_(NULL),
-turn_(0) {
+action_pool_(NULL),
+watchdog_(NULL),
+ponderer_(NULL),
+turn_(0),
+search_completeness_(1),
+has_search_threads_(true),
+search_pool_(NULL),
+search_version_(0) {
 }
 
 Bot::~Bot() {
+#ifdef WITH_PARALLEL_SEARCH
+    //Stop the search threads before deleting the bots they use.
+    delete search_pool_;
+
+    for (uint i = 0; i < search_bots_.size(); ++i) {
+        delete search_bots_[i];
+    }
+#endif
+
     delete timeline_;
+    delete action_pool_;
 }
 
 void Bot::SetGame(GameMap* game) {
@@ -38,16 +71,29 @@ void Bot::SetGame(GameMap* game) {
 
     const int num_planets = game->NumPlanets();
     when_is_feeder_allowed_to_attack_.resize(num_planets * num_planets, -1);
+
+#ifdef WITH_PARALLEL_SEARCH
+    this->StartSearchThreads();
+#endif
+}
+
+void Bot::SetNumSearchThreads(const int num_threads) {
+    s_num_search_threads_ = num_threads;
+}
+
+void Bot::SetReturnBoundPruning(const bool is_enabled) {
+    s_is_return_bound_pruning_ = is_enabled;
 }
 
 ActionList Bot::MakeMoves() {
     ++turn_;
 
-    if (game_->Turn() != 1) {
+    if (NULL != action_pool_) {
         timeline_->Update();
 
     } else {
-        ActionPool* actionPool = new ActionPool();
+        //The first turn for this bot.  The timeline is fresh from SetGame().
+        action_pool_ = new ActionPool();
     }
 
 #ifndef IS_SUBMISSION
@@ -65,6 +111,11 @@ ActionList Bot::MakeMoves() {
 
     timeline_->SetFeederAttackPermissions(&when_is_feeder_allowed_to_attack_);
 
+    //Once told to stop, such as by the watchdog, the rest of the work would go unused.
+    if (IsStopRequested()) {
+        return my_best_actions;
+    }
+
 #ifdef MAKE_ENEMY_MOVES_ON_FIRST_TURN
     if (1 == turn_) {
         //On the first turn, consider what the enemy would do.
@@ -75,8 +126,16 @@ ActionList Bot::MakeMoves() {
     //Mark the reinforcers.
     this->MarkReinforcers(kMe);
 
+    if (IsStopRequested()) {
+        return my_best_actions;
+    }
+
     ActionList found_actions = this->FindActionsFor(kMe); 
     my_best_actions.insert(my_best_actions.end(), found_actions.begin(), found_actions.end());
+
+    if (IsStopRequested()) {
+        return my_best_actions;
+    }
     
     ActionList fleet_reinforcements = this->SendFleetsToFront(kMe);
     my_best_actions.insert(my_best_actions.end(), fleet_reinforcements.begin(), fleet_reinforcements.end());
@@ -136,6 +195,7 @@ ActionList Bot::FindActionsFor(const int player) {
         }
         
         picking_round_++;
+        const bool is_out_of_time = (search_completeness_ < 1);
 
         //Add these actions to the list of other actions.
         for (uint i = 0; i < best_actions.size(); ++i) {
@@ -162,6 +222,24 @@ ActionList Bot::FindActionsFor(const int player) {
 #endif
 
         timeline_->ApplyActions(best_actions);
+
+#ifdef WITH_WATCHDOG
+        //These orders can be sent as they are if the turn runs out of time.
+        if (NULL != watchdog_ && kMe == player) {
+            watchdog_->Publish(player_actions);
+        }
+#endif
+
+#ifdef WITH_PONDERING
+        //Likewise for the moves found while pondering.
+        if (NULL != ponderer_ && kMe == player) {
+            ponderer_->Publish(player_actions);
+        }
+#endif
+
+        if (is_out_of_time || IsStopRequested()) {
+            break;  //No time is left for more picking rounds.
+        }
     }
 
 //#ifndef IS_SUBMISSION
@@ -238,7 +316,9 @@ ActionList Bot::BestRemainingMove(PlanetTimelineList& invadeable_planets,
     FindInvasionPlanSettings invasion_settings;
 #endif
 
-    //Find the best plan of action.
+    //List the targets and arrival times to consider.
+    std::vector<MoveCandidate> candidates;
+
 	for (uint i = 0; i < invadeable_planets.size(); ++i) {
 		PlanetTimeline* target = invadeable_planets[i];
         const int target_id = target->Id();
@@ -247,106 +327,490 @@ ActionList Bot::BestRemainingMove(PlanetTimelineList& invadeable_planets,
             continue;
         }
 
-#ifndef IS_SUBMISSION
-        if (depth == 1) {
-            int x = 2;
-        }
-#endif
-
-        //Planets that might be participating in the invasion, sorted by distance from target.
+        //The closest planet that might be participating in the invasion.
 		PlanetTimelineList sources = timeline_->EverOwnedTimelinesByDistance(player, target);
 
         if (sources.empty()) {
-            continue;   //To the next arrival time.
+            continue;   //To the next target.
         }
         
-        //Pre-calculate distances to the sources.
-		std::vector<int> distances_to_sources(sources.size());
-
-		for (uint s = 0; s < sources.size(); ++s) {
-			distances_to_sources[s] = game_->GetDistance(sources[s]->Id(), target_id);
-		}
-
 		//Find earliest time the fleet can reach the target.
         const int earliest_allowed_arrival = earliest_arrivals[i];
-        const int earliest_possible_arrival = distances_to_sources[0] + earliest_allowed_departure;
+        const int earliest_possible_arrival = 
+            game_->GetDistance(sources[0]->Id(), target_id) + earliest_allowed_departure;
         const int earliest_arrival = std::max(earliest_allowed_arrival, earliest_possible_arrival);
-        
+
+        for (int arrival_time = earliest_arrival; arrival_time < latest_arrivals[i]; ++arrival_time) {
+            MoveCandidate candidate;
+            candidate.target_index = i;
+            candidate.arrival_time = arrival_time;
+            candidates.push_back(candidate);
+        }
+	}
+
+    //Find the best plan of action.
+#ifdef WITH_PARALLEL_SEARCH
+    const uint num_search_threads = search_bots_.size();
+
+    uint num_covered = 0;
+
+    if (num_search_threads > 1 && candidates.size() >= 2 * num_search_threads) {
+        best_return = this->ParallelEvaluateCandidates(invadeable_planets, player, candidates, 
+            &invasion_settings, best_return, best_actions, num_covered, has_timed_out);
+    
+    } else {
+#else
+    uint num_covered = 0;
+#endif
+        int best_candidate = -1;
+        best_return = this->EvaluateCandidates(invadeable_planets, player, candidates, 0, candidates.size(),
+            &invasion_settings, best_return, best_actions, best_candidate, num_covered, has_timed_out);
+#ifdef WITH_PARALLEL_SEARCH
+    }
+#endif
+
+    search_completeness_ = 
+        (candidates.empty() ? 1.0 : static_cast<double>(num_covered) / candidates.size());
+
+    if (has_timed_out) {
+#ifdef WITH_ANYTIME_SEARCH
+        //Keep the best plan found so far.  It has been fully checked, just not
+        //against every other candidate.
+#else
+        //Don't send incomplete answers.
+        Action::FreeActions(best_actions);
+        best_actions.clear();
+#endif
+    }
+
+	return best_actions;
+}
+
+//Order plans by decreasing estimated return.
+static bool HasHigherReturnBound(const ScoredPlan& a, const ScoredPlan& b) {
+    return a.return_bound > b.return_bound;
+}
+
+//Raise a return shared between the search threads to at least the given value.
+static void RaiseSharedReturn(std::atomic<double>* shared_return, const double value) {
+    double current = shared_return->load();
+
+    while (current < value && !shared_return->compare_exchange_weak(current, value)) {
+    }
+}
+
+double Bot::EvaluateCandidates(const PlanetTimelineList& invadeable_planets,
+                               const int player,
+                               const std::vector<MoveCandidate>& candidates,
+                               const uint begin,
+                               const uint end,
+                               FindInvasionPlanSettings* invasion_settings,
+                               double best_return,
+                               ActionList& best_actions,
+                               int& best_candidate,
+                               uint& num_covered,
+                               bool& has_timed_out,
+                               std::atomic<double>* shared_best_return) {
+    ActionList invasion_plan;
+    invasion_plan.reserve(20);
+    std::vector<ScoredPlan> scored_plans;
+    scored_plans.reserve(end - begin);
+    
+    //The targets are given as the planets of the timeline that listed them, which
+    //may be another thread's.  Use the same planets in this bot's own timeline.
+    int target_index = -1;
+    PlanetTimeline* target = NULL;
+    InvasionSweep sweep;
+    uint num_planned = 0;
+
+    //Part of the return bound of every plan.
+    const int ships_lost_to_balances = timeline_->ShipsLostToBalances();
+
+    for (uint c = begin; c < end; ++c) {
+        const MoveCandidate& candidate = candidates[c];
+        const int arrival_time = candidate.arrival_time;
+
+        if (candidate.target_index != target_index) {
+            target_index = candidate.target_index;
+            target = timeline_->Timeline(invadeable_planets[target_index]->Id());
+
+            //The target's candidates come in the order of their arrival times.
+            this->StartInvasionSweep(sweep, target, player, invasion_settings);
+        }
+
 #ifndef IS_SUBMISSION
-        if (1 == picking_round_ && 5 == target_id) {
+        if (1 == picking_round_ && 5 == target->Id() && 12 == arrival_time) {
             int x = 2;
         }
 #endif
+        //Only the sources that can reach the target in time contribute to the plan.
+        this->AdvanceInvasionSweep(sweep, arrival_time);
+        invasion_plan = this->FindInvasionPlan(sweep);
+
+        if (!invasion_plan.empty()) {
+            ScoredPlan scored_plan;
+            scored_plan.candidate = static_cast<int>(c);
+            scored_plan.return_bound = this->ReturnBoundForMove(invasion_plan, ships_lost_to_balances);
+            scored_plan.plan = invasion_plan;
+            scored_plans.push_back(scored_plan);
+            invasion_plan.clear();
+        }
 
-        for (int arrival_time = earliest_arrival; arrival_time < latest_arrivals[i]; ++arrival_time) {
-#ifndef IS_SUBMISSION
-            if (1 == picking_round_ && 5 == target_id && 12 == arrival_time) {
-                int x = 2;
-            }
+        ++num_planned;
+
+#ifdef WITH_TIMEOUTS
+        if (HasTimedOut()) {
+            has_timed_out = true;
+            break;
+        }
 #endif
-            invasion_plan = 
-                this->FindInvasionPlan(target, arrival_time, sources, distances_to_sources, player, &invasion_settings);            
-
-            //Check whether this move is better than any other we've seen so far.
-            if (!invasion_plan.empty()) {
-                const double return_ratio = this->ReturnForMove(invasion_plan, best_return);
-                //const double return_ratio = this->ReturnForMove2(invasion_plan, best_return, depth);
-
-                if (best_return < return_ratio) {
-                    best_return = return_ratio;
-                    Action::FreeActions(best_actions);
-                    best_actions = invasion_plan;
-                    invasion_plan.clear();
-
-                } else {
-                    Action::FreeActions(invasion_plan);
-                    invasion_plan.clear();
-                }
+    }
+
+#if defined(PRUNE_BY_RETURN_BOUND) || defined(WITH_ANYTIME_SEARCH)
+    //Check the most promising plans first, and stop once no remaining plan
+    //can beat the best one.
+    std::stable_sort(scored_plans.begin(), scored_plans.end(), HasHigherReturnBound);
+#endif
+    uint next_plan = 0;
+    bool is_search_settled = true;
+
+    for (; next_plan < scored_plans.size(); ++next_plan) {
+        ScoredPlan& scored_plan = scored_plans[next_plan];
+
+#ifdef WITH_ANYTIME_SEARCH
+        //Out of time.  Still check the most promising plan if none has been checked 
+        //yet, so that a slow turn does not go without any moves.
+        if (has_timed_out && 0 != next_plan) {
+            is_search_settled = false;
+            break;
+        }
+#else
+        if (has_timed_out) {
+            is_search_settled = false;
+            break;
+        }
+#endif
+
+#ifdef PRUNE_BY_RETURN_BOUND
+        //Neither this plan nor the ones after it can beat or tie the best plan found 
+        //so far, on this search thread or any other.  The bound only holds for my
+        //moves, as the returns are counted from my side.
+        const double best_found_return = (NULL != shared_best_return 
+            ? std::max(best_return, shared_best_return->load()) : best_return);
+
+        if (s_is_return_bound_pruning_ && kMe == player && scored_plan.return_bound < best_found_return) {
+            break;
+        }
+#endif
+
+        //Check whether this move is better than any other we've seen so far.  Among
+        //equally good moves, prefer the one listed first.
+        const double return_ratio = this->ReturnForMove(scored_plan.plan, best_return);
+        //const double return_ratio = this->ReturnForMove2(invasion_plan, best_return, depth);
+        const bool is_tie = (best_return == return_ratio && scored_plan.candidate < best_candidate);
+        pw_assert((kMe != player || return_ratio <= scored_plan.return_bound) && "The return bound is too low.");
+
+        if (best_return < return_ratio || is_tie) {
+            best_return = return_ratio;
+            best_candidate = scored_plan.candidate;
+            Action::FreeActions(best_actions);
+            best_actions = scored_plan.plan;
+
+            if (NULL != shared_best_return) {
+                RaiseSharedReturn(shared_best_return, best_return);
             }
 
+        } else {
+            Action::FreeActions(scored_plan.plan);
+        }
+
 #ifdef WITH_TIMEOUTS
-            if (HasTimedOut()) {
-                has_timed_out = true;
-                break;
-            }
+        if (HasTimedOut()) {
+            has_timed_out = true;
+        }
 #endif
+    }
+
+    //The plans that were not checked or ruled out are not covered.
+    num_covered = num_planned - (is_search_settled ? 0 : scored_plans.size() - next_plan);
+
+    for (; next_plan < scored_plans.size(); ++next_plan) {
+        Action::FreeActions(scored_plans[next_plan].plan);
+    }
+
+    return best_return;
+}
+
+void Bot::RecordActions(const ActionList& actions, std::vector<ActionRecord>& records) {
+    records.resize(actions.size());
+
+    for (uint i = 0; i < actions.size(); ++i) {
+        Action* action = actions[i];
+        ActionRecord& record = records[i];
+        record.owner = action->Owner();
+        record.source_id = action->Source()->Id();
+        record.target_id = action->Target()->Id();
+        record.distance = action->Distance();
+        record.departure_time = action->DepartureTime();
+        record.num_ships = action->NumShips();
+        record.is_contingent = action->IsContingent();
+    }
+}
+
+ActionList Bot::RestoreActions(const std::vector<ActionRecord>& records) {
+    ActionList actions;
+    actions.reserve(records.size());
+
+    for (uint i = 0; i < records.size(); ++i) {
+        const ActionRecord& record = records[i];
+        Action* action = Action::Get();
+        action->SetOwner(record.owner);
+        action->SetSource(timeline_->Timeline(record.source_id));
+        action->SetTarget(timeline_->Timeline(record.target_id));
+        action->SetDistance(record.distance);
+        action->SetDepartureTime(record.departure_time);
+        action->SetNumShips(record.num_ships);
+        action->SetContingent(record.is_contingent);
+        actions.push_back(action);
+    }
+
+    return actions;
+}
+
+#ifdef WITH_PARALLEL_SEARCH
+/************************************************
+               Parallel search
+************************************************/
+//Evaluate a range of candidate moves on one of the search threads.
+class SearchTask : public Task {
+public:
+    void Run(int worker_id) {
+        bot->RunSearchTask(this, worker_id);
+    }
+
+    //Input.
+    Bot* bot;
+    const PlanetTimelineList* invadeable_planets;
+    int player;
+    const std::vector<MoveCandidate>* candidates;
+    uint begin;
+    uint end;
+    FindInvasionPlanSettings* invasion_settings;
+    long int timer_start;
+    long int timer_timeout;
+    const std::atomic<bool>* stop_flag;
+    double starting_best_return;
+    std::atomic<double>* shared_best_return;
+
+    //Output.
+    double best_return;
+    int best_candidate;
+    uint num_covered;
+    bool has_timed_out;
+    std::vector<ActionRecord> best_plan;
+};
+
+void Bot::StartSearchThreads() {
+    const int num_threads = (0 != s_num_search_threads_ ? 
+        s_num_search_threads_ : static_cast<int>(std::thread::hardware_concurrency()));
+
+    if (num_threads <= 1 || !has_search_threads_) {
+        return;
+    }
+
+    search_pool_ = new ThreadPool(num_threads);
+
+    //Each thread searches with its own bot, which has a copy of the timeline.
+    for (int i = 0; i < search_pool_->NumWorkers(); ++i) {
+        Bot* search_bot = new Bot();
+        search_bot->game_ = game_;
+        search_bot->timeline_ = new GameTimeline();
+        search_bot->timeline_->SetFeederAttackPermissions(&search_bot->when_is_feeder_allowed_to_attack_);
+        search_bot->counter_horizon_ = counter_horizon_;
+        search_bot->defense_horizon_ = defense_horizon_;
+        search_bots_.push_back(search_bot);
+    }
+}
+
+double Bot::ParallelEvaluateCandidates(const PlanetTimelineList& invadeable_planets,
+                                       const int player,
+                                       const std::vector<MoveCandidate>& candidates,
+                                       FindInvasionPlanSettings* invasion_settings,
+                                       double best_return,
+                                       ActionList& best_actions,
+                                       uint& num_covered,
+                                       bool& has_timed_out) {
+    //The search threads need to copy the timeline before searching.
+    ++search_version_;
+
+    long int timer_start = 0;
+    long int timer_timeout = 0;
+    GetTimer(&timer_start, &timer_timeout);
+    const std::atomic<bool>* stop_flag = GetStopFlag();
+
+    //The best return found so far by any of the tasks, to prune against.
+    std::atomic<double> shared_best_return(best_return);
+
+    //Deal out the candidates in contiguous ranges, several per thread, so that
+    //threads that finish early can steal the remaining ranges.
+    const uint num_tasks = std::min(candidates.size(), 4 * search_bots_.size());
+    std::vector<SearchTask> tasks(num_tasks);
+
+    for (uint i = 0; i < num_tasks; ++i) {
+        SearchTask& task = tasks[i];
+        task.bot = this;
+        task.invadeable_planets = &invadeable_planets;
+        task.player = player;
+        task.candidates = &candidates;
+        task.begin = candidates.size() * i / num_tasks;
+        task.end = candidates.size() * (i + 1) / num_tasks;
+        task.invasion_settings = invasion_settings;
+        task.timer_start = timer_start;
+        task.timer_timeout = timer_timeout;
+        task.stop_flag = stop_flag;
+        task.starting_best_return = best_return;
+        task.shared_best_return = &shared_best_return;
+        search_pool_->Submit(&task);
+    }
+
+    search_pool_->Wait();
 
+    //Pick the best plan the way a sequential search would.  Among equally good 
+    //plans, pick the one listed first.
+    const SearchTask* best_task = NULL;
+    int best_candidate = -1;
+
+    for (uint i = 0; i < num_tasks; ++i) {
+        const SearchTask& task = tasks[i];
+        has_timed_out |= task.has_timed_out;
+        num_covered += task.num_covered;
+
+        if (-1 == task.best_candidate) {
+            continue;   //No plan beat the starting return.
         }
 
-        if (has_timed_out) {
-            break;
+        const bool is_tie = (best_return == task.best_return && task.best_candidate < best_candidate);
+
+        if (best_return < task.best_return || is_tie) {
+            best_return = task.best_return;
+            best_candidate = task.best_candidate;
+            best_task = &task;
         }
-	}//End iterating over targets.
+    }
 
-    if (has_timed_out) {
-        //Don't send incomplete answers.
+    if (NULL != best_task) {
         Action::FreeActions(best_actions);
-        best_actions.clear();
+        best_actions = this->RestoreActions(best_task->best_plan);
     }
 
-	return best_actions;
+    return best_return;
 }
 
-ActionList Bot::FindInvasionPlan(PlanetTimeline* target, 
-                                 const int arrival_time, 
-                                 const PlanetTimelineList& sources, 
-                                 const std::vector<int>& distances_to_sources,
-                                 const int player, 
-                                 FindInvasionPlanSettings* settings) {
+void Bot::RunSearchTask(SearchTask* task, const int worker_id) {
+    Bot* search_bot = search_bots_[worker_id];
+
+    //The action pool must be created on the thread that uses it.
+    if (NULL == search_bot->action_pool_) {
+        search_bot->action_pool_ = new ActionPool();
+    }
+
+    if (search_bot->search_version_ != search_version_) {
+        //The forked timeline reads the search bot's own copy of the permissions.
+        search_bot->when_is_feeder_allowed_to_attack_ = when_is_feeder_allowed_to_attack_;
+        search_bot->timeline_->Fork(timeline_);
+        search_bot->turn_ = turn_;
+        search_bot->picking_round_ = picking_round_;
+        search_bot->search_version_ = search_version_;
+    }
+
+    SetTimer(task->timer_start, task->timer_timeout);
+    SetStopFlag(task->stop_flag);
+
+    ActionList best_plan;
+    task->best_candidate = -1;
+    task->num_covered = 0;
+    task->has_timed_out = false;
+    task->best_return = search_bot->EvaluateCandidates(*task->invadeable_planets, 
+                                                      task->player, 
+                                                      *task->candidates, 
+                                                      task->begin, 
+                                                      task->end, 
+                                                      task->invasion_settings, 
+                                                      task->starting_best_return, 
+                                                      best_plan, 
+                                                      task->best_candidate, 
+                                                      task->num_covered, 
+                                                      task->has_timed_out,
+                                                      task->shared_best_return);
+
+    //Hand the plan over as plain data; the actions go back to this thread's pool.
+    RecordActions(best_plan, task->best_plan);
+    Action::FreeActions(best_plan);
+}
+#endif
+
+void Bot::StartInvasionSweep(InvasionSweep& sweep, 
+                             PlanetTimeline* target, 
+                             const int player, 
+                             FindInvasionPlanSettings* settings) {
+    sweep.target = target;
+    sweep.player = player;
+    sweep.settings = settings;
+    sweep.arrival_time = 0;
+    sweep.num_reachable_sources = 0;
+
+    //Planets that might be participating in the invasion, sorted by distance from target.
+    sweep.sources = timeline_->EverOwnedTimelinesByDistance(player, target);
+    sweep.distances_to_sources.resize(sweep.sources.size());
+
+    for (uint s = 0; s < sweep.sources.size(); ++s) {
+        sweep.distances_to_sources[s] = game_->GetDistance(sweep.sources[s]->Id(), target->Id());
+    }
+
+    sweep.ships_farther_than.resize(static_cast<uint>(timeline_->Horizon()));
+}
+
+void Bot::AdvanceInvasionSweep(InvasionSweep& sweep, const int arrival_time) {
+    //The sources that can reach the target only grow with the arrival time.
+    if (arrival_time < sweep.arrival_time) {
+        sweep.num_reachable_sources = 0;
+    }
+
+    sweep.arrival_time = arrival_time;
+
+    while (sweep.num_reachable_sources < sweep.sources.size() 
+        && sweep.distances_to_sources[sweep.num_reachable_sources] <= arrival_time) {
+        ++sweep.num_reachable_sources;
+    }
+}
+
+ActionList Bot::FindInvasionPlan(InvasionSweep& sweep) {
     ActionList invasion_plan;
 
+    if (0 == sweep.num_reachable_sources) {
+        return invasion_plan;   //No source can reach the target in time.
+    }
+
     //Various useful variables.
+    PlanetTimeline* const target = sweep.target;
+    const int arrival_time = sweep.arrival_time;
+    const PlanetTimelineList& sources = sweep.sources;
+    const std::vector<int>& distances_to_sources = sweep.distances_to_sources;
+    const int player = sweep.player;
+    FindInvasionPlanSettings* const settings = sweep.settings;
     const int target_id = target->Id();
     const int owner_adjustment = (NULL != settings ? settings->owner_adjustment : 0);
     const int target_owner = (owner_adjustment == -1 ? target->OwnerAt(arrival_time) : owner_adjustment);
     const int balances_offset = arrival_time * (arrival_time - 1) / 2 - 1;
-    const int horizon = timeline_->Horizon();
-    const int u_horizon = static_cast<uint>(horizon);
     const int num_planets = game_->NumPlanets();
-    const std::vector<int>& balances = target->Balances();
+    const int* balances = target->Balances();
     const int opponent = OtherPlayer(player);
     const int distance_to_first_source = distances_to_sources[0];
-    std::vector<int> ships_farther_than(u_horizon, 0);
+
+    //Only the distances up to the arrival time are used.
+    std::vector<int>& ships_farther_than = sweep.ships_farther_than;
+    std::fill(ships_farther_than.begin() + distance_to_first_source, 
+              ships_farther_than.begin() + arrival_time + 1, 0);
 
     //Possible adjustment for neutral planets in case of an opponent.
     const int neutral_adjustment = 
@@ -403,22 +867,16 @@ ActionList Bot::FindInvasionPlan(PlanetTimeline* target,
     //Compose the invasion plan.
 	int ships_to_send = 0;
     int current_distance = distances_to_sources[0];
+    sweep.plan_sources.clear();
+    sweep.plan_num_ships.clear();
 
-    for (uint s = 0; s < sources.size(); ++s) {
+    for (uint s = 0; s < sweep.num_reachable_sources; ++s) {
         pw_assert(remaining_ships_needed > 0);
         PlanetTimeline* source = sources[s];
         const int source_id = source->Id();
-
-		//Check whether the target is reacheable from the source.  If not, then it
-		//won't be reacheable from any of the remaining sources.
         const int distance_to_source = distances_to_sources[s];
         const int departure_time = arrival_time - distance_to_source;
 
-		//if (distance_to_source > (arrival_time - earliest_allowed_departure)) {
-		if (distance_to_source > (arrival_time)) {
-            break;
-		}
-
         //Feeder planets may only attack neutrals or support player's planets.
         if (source->IsReinforcer() && opponent == target_owner && !was_my_planet) {
             if (when_is_feeder_allowed_to_attack_[source_id * num_planets + target_id] != departure_time) {
@@ -449,12 +907,12 @@ ActionList Bot::FindInvasionPlan(PlanetTimeline* target,
         }
         
         //Check whether the source has any ships to send.
-        const int available_ships = source->ShipsFree(arrival_time - distance_to_source, player);
+        const int available_ships = source->ShipsFree(departure_time, player);
         if(0 == available_ships) {
             continue;
         
         } else {
-            pw_assert(source->IsOwnedBy(player, arrival_time - distance_to_source));
+            pw_assert(source->IsOwnedBy(player, departure_time));
         }
 
         if (max_ships_from_this_distance == 0) {
@@ -463,16 +921,8 @@ ActionList Bot::FindInvasionPlan(PlanetTimeline* target,
         
         //Add ships from this planet.
         const int ships_to_send_from_here = std::min(available_ships, max_ships_from_this_distance);
-        
-        Action* action = Action::Get();
-        action->SetOwner(player);
-        action->SetSource(source);
-        action->SetTarget(target);
-        action->SetDistance(distance_to_source);
-		action->SetDepartureTime(arrival_time - distance_to_source);
-        action->SetNumShips(ships_to_send_from_here);
-        
-        invasion_plan.push_back(action);
+        sweep.plan_sources.push_back(s);
+        sweep.plan_num_ships.push_back(ships_to_send_from_here);
 
         ships_to_send += ships_to_send_from_here;
         remaining_ships_needed -= ships_to_send_from_here;
@@ -487,13 +937,47 @@ ActionList Bot::FindInvasionPlan(PlanetTimeline* target,
 
     //Return the invasion plan only if we've found enough ships to do the job.
     if (remaining_ships_needed > 0 || 0 == ships_to_send) {
-        Action::FreeActions(invasion_plan);
-        invasion_plan.clear();
+        return invasion_plan;
+    }
+
+    invasion_plan.reserve(sweep.plan_sources.size());
+
+    for (uint i = 0; i < sweep.plan_sources.size(); ++i) {
+        const uint s = sweep.plan_sources[i];
+        const int distance_to_source = distances_to_sources[s];
+
+        Action* action = Action::Get();
+        action->SetOwner(player);
+        action->SetSource(sources[s]);
+        action->SetTarget(target);
+        action->SetDistance(distance_to_source);
+		action->SetDepartureTime(arrival_time - distance_to_source);
+        action->SetNumShips(sweep.plan_num_ships[i]);
+        
+        invasion_plan.push_back(action);
     }
 
     return invasion_plan;
 }
 
+double Bot::ReturnBoundForMove(const ActionList& invasion_plan, const int ships_lost_to_balances) {
+    //Calculate the number of ships sent.
+    double ships_to_send = 0;
+    for (uint i = 0; i < invasion_plan.size(); ++i) {
+        ships_to_send += static_cast<double>(invasion_plan[i]->NumShips());
+    }
+
+    //The fleets only change the target from their arrival on, and the sources can 
+    //only lose ships by sending them.  The balances don't change who owns what, 
+    //so elsewhere the move can only win back the ships lost to them.
+    PlanetTimeline* target = invasion_plan[0]->Target();
+    const int arrival_time = invasion_plan[0]->DepartureTime() + invasion_plan[0]->Distance();
+    const double multiplier = (kEnemy == target->OwnerAt(arrival_time) ? kAggressionReturnMultiplier : 1);
+    const int ships_gained = target->ShipsGainedIfMineFrom(arrival_time) + ships_lost_to_balances;
+    const double return_ratio = (static_cast<double>(ships_gained) / ships_to_send) * multiplier;
+    return return_ratio;
+}
+
 double Bot::ReturnForMove(const ActionList& invasion_plan, const double best_return) {
     if (invasion_plan.empty()) {
         return 0;
@@ -507,24 +991,13 @@ double Bot::ReturnForMove(const ActionList& invasion_plan, const double best_ret
         ships_to_send += static_cast<double>(invasion_plan[i]->NumShips());
     }
 
-    //Find a rough upper limit of how good this move could be.
     PlanetTimeline* target = invasion_plan[0]->Target();
     const int arrival_time = invasion_plan[0]->DepartureTime() + invasion_plan[0]->Distance();
     const double multiplier = (kEnemy == target->OwnerAt(arrival_time) ? kAggressionReturnMultiplier : 1);
-    const int ships_gained = target->ShipsGainedForActions(invasion_plan);
-    const double return_ratio = (static_cast<double>(ships_gained) / ships_to_send) * multiplier;
-
-    //Don't be as restrictive on the first turn.
-    const int first_departure_time = invasion_plan[invasion_plan.size() - 1]->DepartureTime(); 
-    const int is_first_turn = (turn_ == 1) && (first_departure_time == 0);
-    
-    if (best_return >= return_ratio && is_first_turn) {
-        //The upper limit doesn't beat the best move so far.
-        return return_ratio;
-    }
 
     //Perform a more thorough check of the move.  Apply it to the timeline, and see how it
     //impacts ship returns and strategic balances.
+    timeline_->PushSavepoint();
     timeline_->ApplyTempActions(invasion_plan);
     PlanetTimelineList sources_and_targets = Action::SourcesAndTargets(invasion_plan);
     timeline_->UpdateBalances(sources_and_targets);
@@ -534,11 +1007,11 @@ double Bot::ReturnForMove(const ActionList& invasion_plan, const double best_ret
     
     if (best_return < updated_return_ratio) {
         //It is definitely a good move.
-        timeline_->ResetTimelinesToBase();
+        timeline_->PopSavepoint();
         return updated_return_ratio;
     }
 
-    timeline_->ResetTimelinesToBase();
+    timeline_->PopSavepoint();
     return updated_return_ratio;
 
     //At this point, the move seems to impact the strategic balances negatively.
@@ -664,6 +1137,9 @@ double Bot::ReturnForMove2(ActionList &invasion_plan, double best_return, const
 CounterActionResult Bot::ShipsGainedForAfterMove(const ActionList& invasion_plan, 
                                          PlanetTimelineList& counter_targets,
                                          const int attack_arrival_time) {
+    //Evaluate the counter-attack and the defense on top of the invasion; the
+    //candidate moves tried along the way are rolled back to this point.
+    timeline_->PushSavepoint();
     timeline_->ApplyTempActions(invasion_plan);
     CounterActionResult result;
     const int horizon = timeline_->Horizon();
@@ -778,7 +1254,7 @@ CounterActionResult Bot::ShipsGainedForAfterMove(const ActionList& invasion_plan
     }
 
     result.ships_gained = timeline_->ShipsGainedFromBase();
-    timeline_->ResetTimelinesToBase();
+    timeline_->PopSavepoint();
     
     //Update the ships to commit to this.
     Action::FreeActions(best_counter_actions);
@@ -1021,7 +1497,6 @@ ActionList Bot::FindSupportPlanFor(PlanetTimeline *planet, const int player) {
     //Find a way to supply enough forces to maintain ownerships of the planet for as long
     //as possible.
     int x = 2;
-    const int planet_id = planet->Id();
     const int horizon = timeline_->Horizon();
     const uint u_horizon = static_cast<uint>(horizon);
 
@@ -1056,17 +1531,12 @@ ActionList Bot::FindSupportPlanFor(PlanetTimeline *planet, const int player) {
     }
     
     //Find the planets that could support the current planet, and distances to them.
-	PlanetTimelineList sources = timeline_->EverOwnedTimelinesByDistance(player, planet);
+    InvasionSweep sweep;
+    this->StartInvasionSweep(sweep, planet, player);
 
-    if (sources.empty()) {
+    if (sweep.sources.empty()) {
         return support_actions;
     }
-    
-	std::vector<int> distances_to_sources(sources.size());
-
-	for (uint s = 0; s < sources.size(); ++s) {
-		distances_to_sources[s] = game_->GetDistance(sources[s]->Id(), planet_id);
-	}
 
     //Find the necessary ships combinations.
     ActionList candidate_support_actions;
@@ -1080,7 +1550,8 @@ ActionList Bot::FindSupportPlanFor(PlanetTimeline *planet, const int player) {
             break;
         }
 
-        ActionList actions = this->FindInvasionPlan(planet, arrival_time, sources, distances_to_sources, player);
+        this->AdvanceInvasionSweep(sweep, arrival_time);
+        ActionList actions = this->FindInvasionPlan(sweep);
 
         if (actions.empty()) {
             break;
@@ -1117,12 +1588,13 @@ ActionList Bot::FindSupportPlanFor(PlanetTimeline *planet, const int player) {
             temp_action_list.push_back(candidate_support_actions[i]);
         }
 
+        timeline_->PushSavepoint();
         timeline_->ApplyTempActions(temp_action_list);
         sources_and_targets = Action::SourcesAndTargets(temp_action_list);
         timeline_->UpdateBalances(sources_and_targets);
 
         const bool is_appliable = timeline_->HasNegativeBalanceWorsenedFor(test_planets);
-        timeline_->ResetTimelinesToBase();
+        timeline_->PopSavepoint();
 
         if (is_appliable && (current_group == upper_group)) {
             found_limit = true;
@@ -1159,12 +1631,13 @@ ActionList Bot::FindSupportPlanFor(PlanetTimeline *planet, const int player) {
 
 double Bot::ReturnOnSupportPlan(const ActionList& support_plan) {
     //Find ships gained.
+    timeline_->PushSavepoint();
     timeline_->ApplyTempActions(support_plan);
     PlanetTimelineList sources_and_targets = Action::SourcesAndTargets(support_plan);
     timeline_->UpdateBalances(sources_and_targets);
 
     const int ships_gained = timeline_->ShipsGainedFromBase();
-    timeline_->ResetTimelinesToBase();
+    timeline_->PopSavepoint();
 
     //Find ships sent.
     int ships_sent = 0;
@@ -1187,3 +1660,14 @@ invade_neutral_planets(true),
 balance_adjustment(0),
 owner_adjustment(-1) {
 }
+
+/************************************************
+               InvasionSweep class
+************************************************/
+InvasionSweep::InvasionSweep()
+:target(NULL),
+player(0),
+settings(NULL),
+arrival_time(0),
+num_reachable_sources(0) {
+}
@@ -6,6 +6,8 @@
 #ifndef PLANET_WARS_BOT_H_
 #define PLANET_WARS_BOT_H_
 
+#include <atomic>
+
 #include "PlanetWars.h"
 #include "GameTimeline.h"
 #include "Actions.h"
@@ -13,6 +15,14 @@
 class GameTimeline;
 class CounterActionResult;
 class FindInvasionPlanSettings;
+class InvasionSweep;
+class MoveCandidate;
+class ScoredPlan;
+class ActionRecord;
+class SearchTask;
+class ThreadPool;
+class Watchdog;
+class Ponderer;
 
 class Bot {
 public:
@@ -24,10 +34,33 @@ public:
     //Initialization.
     void SetGame(GameMap* game);
 
+    //Publish the orders settled on so far to a watchdog, if one is given.
+    void SetWatchdog(Watchdog* watchdog)        {watchdog_ = watchdog;}
+
     //Decide which fleets to send.  This is the main move logic function.
     ActionList MakeMoves();
 
+    //Number of threads that bots created after this call will use to search
+    //for moves.  0 means one thread per core.
+    static void SetNumSearchThreads(int num_threads);
+
+    //Whether the search skips the plans whose return bound can't beat the best
+    //plan found so far.  On by default.  The picks are the same either way, so
+    //turning it off is only useful to check that.
+    static void SetReturnBoundPruning(bool is_enabled);
+
+    //Search on the calling thread only, whatever SetNumSearchThreads() says.
+    //Call before SetGame().
+    void DisableSearchThreads()                 {has_search_threads_ = false;}
+
 private:
+#ifdef WITH_PARALLEL_SEARCH
+    friend class SearchTask;
+#endif
+#ifdef WITH_PONDERING
+    friend class Ponderer;
+#endif
+
     ActionList FindActionsFor(int player);
 
     ActionList BestRemainingMove(PlanetTimelineList& invadeable_planets, 
@@ -37,9 +70,55 @@ private:
                                  const std::vector<int>& latest_arrivals,
                                  int depth = 0);
     
-    ActionList FindInvasionPlan(PlanetTimeline* target, int arrival_time, 
-        const PlanetTimelineList& sources_by_distance, const std::vector<int>& distances_to_sources,
-        int player, FindInvasionPlanSettings* settings = NULL);
+    //Find the invasion plans for a target at increasing arrival times.  Start the
+    //sweep for the target, advance it to each arrival time in turn, and find
+    //the plan for that time.
+    void StartInvasionSweep(InvasionSweep& sweep, PlanetTimeline* target, int player,
+        FindInvasionPlanSettings* settings = NULL);
+    void AdvanceInvasionSweep(InvasionSweep& sweep, int arrival_time);
+    ActionList FindInvasionPlan(InvasionSweep& sweep);
+
+    //Find the best invasion plan among candidates [begin, end).  Return the plan's return,
+    //or best_return if no candidate beats it.  num_covered is set to the number of 
+    //candidates that were either checked or ruled out before running out of time.
+    //If shared_best_return is given, it is the best return found by any search thread,
+    //and is raised whenever this search finds a better plan.
+    double EvaluateCandidates(const PlanetTimelineList& invadeable_planets, 
+                              int player,
+                              const std::vector<MoveCandidate>& candidates,
+                              uint begin,
+                              uint end,
+                              FindInvasionPlanSettings* invasion_settings,
+                              double best_return,
+                              ActionList& best_actions,
+                              int& best_candidate,
+                              uint& num_covered,
+                              bool& has_timed_out,
+                              std::atomic<double>* shared_best_return = NULL);
+
+    //Convert actions to and from plain data.
+    static void RecordActions(const ActionList& actions, std::vector<ActionRecord>& records);
+    ActionList RestoreActions(const std::vector<ActionRecord>& records);
+
+#ifdef WITH_PARALLEL_SEARCH
+    //Same as EvaluateCandidates(), but spread the candidates across the search threads.
+    double ParallelEvaluateCandidates(const PlanetTimelineList& invadeable_planets, 
+                                      int player,
+                                      const std::vector<MoveCandidate>& candidates,
+                                      FindInvasionPlanSettings* invasion_settings,
+                                      double best_return,
+                                      ActionList& best_actions,
+                                      uint& num_covered,
+                                      bool& has_timed_out);
+    void StartSearchThreads();
+    void RunSearchTask(SearchTask* task, int worker_id);
+#endif
+
+    //A cheap upper bound on ReturnForMove() for my moves.  It counts the ships the
+    //target would gain if it were mine from the arrival on, plus the ships that the
+    //planets are expected to lose to the strategic balances, which is the most the
+    //move could win back.
+    double ReturnBoundForMove(const ActionList& invasion_plan, int ships_lost_to_balances);
     double ReturnForMove(const ActionList& invasion_plan, double best_return);
     double ReturnForMove2(ActionList& invasion_plan, double best_return, int depth);
 
@@ -57,13 +136,31 @@ private:
     
     GameMap* game_;
     GameTimeline* timeline_;
+    ActionPool* action_pool_;
+    Watchdog* watchdog_;
+    Ponderer* ponderer_;
     int counter_horizon_;
     int defense_horizon_;
     int turn_;
     int picking_round_;
+
+    //Fraction of the candidate moves that the latest BestRemainingMove() call
+    //covered before running out of time.
+    double search_completeness_;
+
     std::vector<int> when_is_feeder_allowed_to_attack_;
 
     ActionList committed_actions_;
+
+    //See SetReturnBoundPruning().
+    static bool s_is_return_bound_pruning_;
+
+    //Parallel search.  Each search thread has its own bot with a copy of the timeline.
+    static int s_num_search_threads_;
+    bool has_search_threads_;
+    ThreadPool* search_pool_;
+    std::vector<Bot*> search_bots_;
+    int search_version_;
 };
 
 class CounterActionResult {
@@ -72,6 +169,58 @@ public:
     ActionList defense_plan;
 };
 
+//A target and arrival time for an invasion plan.
+class MoveCandidate {
+public:
+    int target_index;
+    int arrival_time;
+};
+
+//An invasion plan for a MoveCandidate, with a rough upper limit of its return.
+class ScoredPlan {
+public:
+    int candidate;
+    double return_bound;
+    ActionList plan;
+};
+
+//A copy of an action that does not belong to any thread's action pool.
+class ActionRecord {
+public:
+    int owner;
+    int source_id;
+    int target_id;
+    int distance;
+    int departure_time;
+    int num_ships;
+    bool is_contingent;
+};
+
+//The state of a sweep of invasion plans for a target, carried over from one
+//arrival time to the next.
+class InvasionSweep {
+public:
+    InvasionSweep();
+
+    PlanetTimeline* target;
+    int player;
+    FindInvasionPlanSettings* settings;
+    int arrival_time;
+
+    //Planets that might be participating in the invasion, sorted by distance
+    //from the target.  The first num_reachable_sources of them can reach the
+    //target by the arrival time.
+    PlanetTimelineList sources;
+    std::vector<int> distances_to_sources;
+    uint num_reachable_sources;
+
+    //Scratch space for the plans.  The actions are only created once a plan
+    //has come together.
+    std::vector<int> ships_farther_than;
+    std::vector<uint> plan_sources;
+    std::vector<int> plan_num_ships;
+};
+
 class FindInvasionPlanSettings {
 public:
     FindInvasionPlanSettings();
@@ -1,14 +1,27 @@
 //Available under GPLv3.
 //Author: Iouri Khramtsov.
 
+#include <algorithm>
+#include <cstring>
+#include <map>
 #include "GameTimeline.h"
 #include "Utils.h"
 
+//The SIMD balance kernels need GCC's target attributes on x86.
+#if defined(WITH_SIMD_BALANCES) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define WITH_AVX2_BALANCES
+    #include <immintrin.h>
+#endif
+
 /************************************************
                GameTimeline class
 ************************************************/
 GameTimeline::GameTimeline()
-: game_(NULL) {
+: game_(NULL),
+when_is_feeder_allowed_to_attack_(NULL) {
+#ifndef IS_SUBMISSION
+    num_checks_since_full_check_ = 0;
+#endif
 }
 
 GameTimeline::~GameTimeline() {
@@ -16,11 +29,18 @@ GameTimeline::~GameTimeline() {
         delete planet_timelines_[i];
         delete base_planet_timelines_[i];
     }
+
+    for (uint i = 0; i < journal_copies_.size(); ++i) {
+        delete journal_copies_[i];
+    }
+
+    Action::FreeActions(forked_actions_);
 }
 
 void GameTimeline::SetGameMap(GameMap* game) {
     game_ = game;
     horizon_ = game->MapRadius() + 5;
+    max_horizon_ = MaxHorizonFor(horizon_);
 
     //Update the ships gained from planets vector.
     PlanetList planets = game->Planets();
@@ -42,9 +62,79 @@ void GameTimeline::SetGameMap(GameMap* game) {
     //Initialize indicators showing whether the base timeline is different
     //from the working timeline.
     are_working_timelines_different_.resize(planet_timelines_.size(), false);
+    timeline_journal_levels_.resize(planet_timelines_.size(), 0);
+    balances_journal_levels_.resize(planet_timelines_.size(), 0);
+    arrivals_by_target_.resize(planet_timelines_.size());
+    needs_recalculation_.resize(planet_timelines_.size(), false);
+}
+
+void GameTimeline::Fork(GameTimeline* original) {
+    pw_assert(savepoints_.empty() && "Forking a timeline during speculation.");
+
+    game_ = original->game_;
+    horizon_ = original->horizon_;
+    max_horizon_ = original->max_horizon_;
+
+    //The feeder attack permissions belong to the bot that owns each timeline.
+    pw_assert(NULL != when_is_feeder_allowed_to_attack_
+        && when_is_feeder_allowed_to_attack_ != original->when_is_feeder_allowed_to_attack_
+        && *when_is_feeder_allowed_to_attack_ == *original->when_is_feeder_allowed_to_attack_);
+
+    const uint num_timelines = original->planet_timelines_.size();
+
+    while (planet_timelines_.size() < num_timelines) {
+        planet_timelines_.push_back(new PlanetTimeline());
+        base_planet_timelines_.push_back(new PlanetTimeline());
+    }
+
+    for (uint i = 0; i < num_timelines; ++i) {
+        planet_timelines_[i]->Copy(original->planet_timelines_[i]);
+        planet_timelines_[i]->SetGameTimeline(this);
+        base_planet_timelines_[i]->Copy(original->base_planet_timelines_[i]);
+        base_planet_timelines_[i]->SetGameTimeline(this);
+    }
+
+    are_working_timelines_different_ = original->are_working_timelines_different_;
+    timeline_journal_levels_.assign(num_timelines, 0);
+    balances_journal_levels_.assign(num_timelines, 0);
+    arrivals_by_target_.resize(num_timelines);
+    needs_recalculation_.assign(num_timelines, false);
+
+    //Point the departing actions at this timeline's planets.  The working and
+    //base timelines share their actions, and so should the copies.
+    Action::FreeActions(forked_actions_);
+    forked_actions_.clear();
+    std::map<Action*, Action*> action_copies;
+
+    for (uint i = 0; i < 2 * num_timelines; ++i) {
+        PlanetTimeline* timeline = 
+            (i < num_timelines ? planet_timelines_[i] : base_planet_timelines_[i - num_timelines]);
+        ActionList& departing_actions = timeline->DepartingActions();
+
+        for (uint j = 0; j < departing_actions.size(); ++j) {
+            Action* action = departing_actions[j];
+            Action*& copy = action_copies[action];
+
+            if (NULL == copy) {
+                copy = Action::Get();
+                copy->SetOwner(action->Owner());
+                copy->SetSource(planet_timelines_[action->Source()->Id()]);
+                copy->SetTarget(planet_timelines_[action->Target()->Id()]);
+                copy->SetDistance(action->Distance());
+                copy->SetDepartureTime(action->DepartureTime());
+                copy->SetNumShips(action->NumShips());
+                copy->SetContingent(action->IsContingent());
+                forked_actions_.push_back(copy);
+            }
+
+            departing_actions[j] = copy;
+        }
+    }
 }
 
 void GameTimeline::Update() {
+    pw_assert(savepoints_.empty() && "Updating the timeline during speculation.");
+
     //Update the planet data.
     for (uint i = 0; i < planet_timelines_.size(); ++i) {
         planet_timelines_[i]->Update();
@@ -61,6 +151,16 @@ int GameTimeline::ShipsGainedForActions(const ActionList& actions, Planet *plane
     return ships_gained;
 }
 
+uint64 GameTimeline::Fingerprint() const {
+    uint64 fingerprint = 0;
+
+    for (uint i = 0; i < planet_timelines_.size(); ++i) {
+        fingerprint ^= planet_timelines_[i]->Fingerprint();
+    }
+
+    return fingerprint;
+}
+
 int GameTimeline::ShipsGainedFromBase() const {
     int ships_gained = 0;
 
@@ -71,6 +171,16 @@ int GameTimeline::ShipsGainedFromBase() const {
     return ships_gained;
 }
 
+int GameTimeline::ShipsLostToBalances() const {
+    int ships_lost = 0;
+
+    for (uint i = 0; i < planet_timelines_.size(); ++i) {
+        ships_lost += planet_timelines_[i]->ShipsLostToBalances();
+    }
+
+    return ships_lost;
+}
+
 PlanetTimeline* GameTimeline::HighestShipLossTimeline() {
     int worst_ship_loss = 0;
     PlanetTimeline* worst_timeline = NULL;
@@ -275,50 +385,54 @@ void GameTimeline::ApplyTempActions(const ActionList& actions) {
 		return;
 	}
 	
-	//Assumption: actions are grouped by their target.
-	
-	//Apply the actions to their target.
-    PlanetTimelineList targets;
-    std::vector<ActionList> actions_for_targets;
+    //Record all the arrivals and departures first, and then recalculate
+    //every changed timeline once.  The targets are recalculated before the
+    //sources, in the order in which they first appear.
+    changed_timelines_.clear();
 
     for (uint i = 0; i < actions.size(); ++i) {
         Action* action = actions[i];
-        PlanetTimeline* target = action->Target();
-        bool found = false;
-
-        for (uint j = 0; j < targets.size(); ++j) {
-            if (targets[j] == target) {
-                actions_for_targets[j].push_back(action);
+        const int target_id = action->Target()->Id();
 
-                found = true;
-            }
+        if (arrivals_by_target_[target_id].empty()) {
+            changed_timelines_.push_back(action->Target());
         }
 
-        if (!found) {
-            targets.push_back(target);
-            ActionList actions_for_this_target;
-            actions_for_this_target.push_back(action);
-            actions_for_targets.push_back(actions_for_this_target);
-        }
+        arrivals_by_target_[target_id].push_back(action);
     }
 
-    for (uint i = 0; i < targets.size(); ++i) {
-        targets[i]->AddArrivals(actions_for_targets[i]);
-        are_working_timelines_different_[targets[i]->Id()] = true;
-    }
+    const uint num_targets = changed_timelines_.size();
 
-	//PlanetTimeline* target = actions[0]->Target();
-	//target->AddArrivals(actions);
-    //are_working_timelines_different_[target->Id()] = true;
+    for (uint i = 0; i < num_targets; ++i) {
+        PlanetTimeline* target = changed_timelines_[i];
+        ActionList& arrivals = arrivals_by_target_[target->Id()];
+
+        needs_recalculation_[target->Id()] = target->RecordArrivals(arrivals);
+        are_working_timelines_different_[target->Id()] = true;
+        arrivals.clear();
+    }
 
 	//Apply the actions to their sources.
 	for (uint i = 0; i < actions.size(); ++i) {
-		//pw_assert(target->Id() == actions[i]->Target()->Id() && "Applied actions must have same target");
-
 		PlanetTimeline* source = actions[i]->Source();
-		source->AddDeparture(actions[i]);
-        are_working_timelines_different_[source->Id()] = true;
+        const int source_id = source->Id();
+
+        if (source->RecordDeparture(actions[i]) && !needs_recalculation_[source_id]) {
+            needs_recalculation_[source_id] = true;
+            changed_timelines_.push_back(source);
+        }
+
+        are_working_timelines_different_[source_id] = true;
 	}
+
+    for (uint i = 0; i < changed_timelines_.size(); ++i) {
+        PlanetTimeline* timeline = changed_timelines_[i];
+
+        if (needs_recalculation_[timeline->Id()]) {
+            needs_recalculation_[timeline->Id()] = false;
+            timeline->RecalculateAfterChanges();
+        }
+    }
 }
 
 void GameTimeline::UnapplyActions(const ActionList &actions) {
@@ -353,6 +467,8 @@ void GameTimeline::UnapplyActions(const ActionList &actions) {
 }
 
 void GameTimeline::ResetTimelinesToBase() {
+    pw_assert(savepoints_.empty() && "Use PopSavepoint() during speculation.");
+
     for (uint i = 0; i < are_working_timelines_different_.size(); ++i) {
         if (are_working_timelines_different_[i]) {
             planet_timelines_[i]->CopyTimeline(base_planet_timelines_[i]);
@@ -368,6 +484,8 @@ void GameTimeline::ResetTimelinesToBase() {
 }
 
 void GameTimeline::SaveTimelinesToBase() {
+    pw_assert(savepoints_.empty() && "Saving the timeline during speculation.");
+
     for (uint i = 0; i < are_working_timelines_different_.size(); ++i) {
         if (are_working_timelines_different_[i]) {
             base_planet_timelines_[i]->CopyTimeline(planet_timelines_[i]);
@@ -386,6 +504,101 @@ void GameTimeline::MarkTimelineAsModified(int timeline_id) {
     are_working_timelines_different_[timeline_id] = true;
 }
 
+int GameTimeline::PushSavepoint() {
+    savepoints_.push_back(journal_.size());
+    return static_cast<int>(savepoints_.size());
+}
+
+void GameTimeline::PopSavepoint() {
+    pw_assert(!savepoints_.empty());
+    const uint savepoint = savepoints_.back();
+
+    //Undo the changes in reverse order, so that the earliest copy of each
+    //timeline is the one that remains.
+    for (uint i = journal_.size(); i > savepoint; --i) {
+        const JournalEntry& entry = journal_[i - 1];
+        const int id = entry.timeline_id;
+        PlanetTimeline* copy = journal_copies_[i - 1];
+
+        if (entry.is_balances_only) {
+            planet_timelines_[id]->CopyBalances(copy);
+        
+        } else {
+            planet_timelines_[id]->CopyTimeline(copy);
+            are_working_timelines_different_[id] = entry.was_different_from_base;
+            timeline_journal_levels_[id] = entry.prev_journal_level;
+        }
+
+        balances_journal_levels_[id] = entry.prev_balances_journal_level;
+    }
+
+    journal_.resize(savepoint);
+    savepoints_.pop_back();
+}
+
+void GameTimeline::PopSavepoints(const int level) {
+    while (static_cast<int>(savepoints_.size()) > level) {
+        this->PopSavepoint();
+    }
+}
+
+void GameTimeline::JournalTimeline(const int timeline_id) {
+    const int level = static_cast<int>(savepoints_.size());
+
+    if (0 == level || level == timeline_journal_levels_[timeline_id]) {
+        return;
+    }
+
+    JournalEntry entry;
+    entry.timeline_id = timeline_id;
+    entry.is_balances_only = false;
+    entry.was_different_from_base = are_working_timelines_different_[timeline_id];
+    entry.prev_journal_level = timeline_journal_levels_[timeline_id];
+    entry.prev_balances_journal_level = balances_journal_levels_[timeline_id];
+
+    if (journal_copies_.size() == journal_.size()) {
+        PlanetTimeline* copy = new PlanetTimeline();
+        copy->Copy(planet_timelines_[timeline_id]);
+        journal_copies_.push_back(copy);
+    
+    } else {
+        journal_copies_[journal_.size()]->CopyTimeline(planet_timelines_[timeline_id]);
+    }
+
+    journal_.push_back(entry);
+
+    //A full copy includes the balances.
+    timeline_journal_levels_[timeline_id] = level;
+    balances_journal_levels_[timeline_id] = level;
+}
+
+void GameTimeline::JournalBalances(const int timeline_id) {
+    const int level = static_cast<int>(savepoints_.size());
+
+    if (0 == level || level == balances_journal_levels_[timeline_id]) {
+        return;
+    }
+
+    JournalEntry entry;
+    entry.timeline_id = timeline_id;
+    entry.is_balances_only = true;
+    entry.was_different_from_base = are_working_timelines_different_[timeline_id];
+    entry.prev_journal_level = timeline_journal_levels_[timeline_id];
+    entry.prev_balances_journal_level = balances_journal_levels_[timeline_id];
+
+    if (journal_copies_.size() == journal_.size()) {
+        PlanetTimeline* copy = new PlanetTimeline();
+        copy->Copy(planet_timelines_[timeline_id]);
+        journal_copies_.push_back(copy);
+    
+    } else {
+        journal_copies_[journal_.size()]->CopyBalances(planet_timelines_[timeline_id]);
+    }
+
+    journal_.push_back(entry);
+    balances_journal_levels_[timeline_id] = level;
+}
+
 int GameTimeline::NegativeBalanceImprovement() {
     int total_improvement = 0;
     
@@ -415,19 +628,163 @@ bool GameTimeline::HasNegativeBalanceWorsenedFor(PlanetTimelineList timelines) {
     return false;
 }
 
+#ifdef WITH_AVX2_BALANCES
+static bool HasAvx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+static const bool kHasAvx2 = HasAvx2();
+
+//Inclusive prefix sums of eight ints.
+__attribute__((target("avx2")))
+static inline __m256i PrefixSums(__m256i x) {
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+
+    //Carry the total of the low four into the high four.
+    const __m256i low_total = _mm256_shuffle_epi32(_mm256_permute2x128_si256(x, x, 0x08), 0xFF);
+    return _mm256_add_epi32(x, low_total);
+}
+
+__attribute__((target("avx2")))
+static inline void UpdateMinMax(const __m256i balances, const int d, const int first_source_distance,
+                                __m256i& mins, __m256i& maxes) {
+    const __m256i distances = _mm256_add_epi32(_mm256_set1_epi32(d), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    const __m256i is_counted = _mm256_cmpgt_epi32(distances, _mm256_set1_epi32(first_source_distance - 1));
+    mins = _mm256_min_epi32(mins, _mm256_blendv_epi8(mins, balances, is_counted));
+    maxes = _mm256_max_epi32(maxes, _mm256_blendv_epi8(maxes, balances, is_counted));
+}
+
+__attribute__((target("avx2")))
+static inline void StoreMinMax(const __m256i mins, const __m256i maxes, int& min_balance, int& max_balance) {
+    __m128i min4 = _mm_min_epi32(_mm256_castsi256_si128(mins), _mm256_extracti128_si256(mins, 1));
+    min4 = _mm_min_epi32(min4, _mm_shuffle_epi32(min4, 0x4E));
+    min4 = _mm_min_epi32(min4, _mm_shuffle_epi32(min4, 0xB1));
+    min_balance = _mm_cvtsi128_si32(min4);
+
+    __m128i max4 = _mm_max_epi32(_mm256_castsi256_si128(maxes), _mm256_extracti128_si256(maxes, 1));
+    max4 = _mm_max_epi32(max4, _mm_shuffle_epi32(max4, 0x4E));
+    max4 = _mm_max_epi32(max4, _mm_shuffle_epi32(max4, 0xB1));
+    max_balance = _mm_cvtsi128_si32(max4);
+}
+
+//Sum up the changes recorded at each distance into a turn's balances, eight
+//distances at a time from distance d, and track the balances' minimum and
+//maximum from first_source_distance on.  Returns the first distance that is
+//left for the scalar loop.
+__attribute__((target("avx2")))
+static int WriteBalancesAvx2(int* balances, const int offset, int d, const int t,
+                             const int* balance_changes, const int first_source_distance,
+                             int& balance, int& min_balance, int& max_balance) {
+    __m256i running_balance = _mm256_set1_epi32(balance);
+    __m256i mins = _mm256_set1_epi32(min_balance);
+    __m256i maxes = _mm256_set1_epi32(max_balance);
+
+    for (; d + 8 <= t + 1; d += 8) {
+        const __m256i changes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(balance_changes + d));
+        const __m256i sums = _mm256_add_epi32(PrefixSums(changes), running_balance);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(balances + offset + d), sums);
+
+        UpdateMinMax(sums, d, first_source_distance, mins, maxes);
+        running_balance = _mm256_permutevar8x32_epi32(sums, _mm256_set1_epi32(7));
+    }
+
+    balance = _mm256_cvtsi256_si32(running_balance);
+    StoreMinMax(mins, maxes, min_balance, max_balance);
+    return d;
+}
+
+//Same as above, but add the changes to the balances already there, and clear the
+//changes as they are used.
+__attribute__((target("avx2")))
+static int AddToBalancesAvx2(int* balances, const int offset, int d, const int t,
+                             int* balance_changes, const int first_source_distance,
+                             int& balance_change, int& min_balance, int& max_balance) {
+    __m256i running_change = _mm256_set1_epi32(balance_change);
+    __m256i mins = _mm256_set1_epi32(min_balance);
+    __m256i maxes = _mm256_set1_epi32(max_balance);
+
+    for (; d + 8 <= t + 1; d += 8) {
+        __m256i* changes_at_d = reinterpret_cast<__m256i*>(balance_changes + d);
+        __m256i* balances_at_d = reinterpret_cast<__m256i*>(balances + offset + d);
+
+        const __m256i changes = _mm256_add_epi32(PrefixSums(_mm256_loadu_si256(changes_at_d)), running_change);
+        const __m256i sums = _mm256_add_epi32(_mm256_loadu_si256(balances_at_d), changes);
+        _mm256_storeu_si256(changes_at_d, _mm256_setzero_si256());
+        _mm256_storeu_si256(balances_at_d, sums);
+
+        UpdateMinMax(sums, d, first_source_distance, mins, maxes);
+        running_change = _mm256_permutevar8x32_epi32(changes, _mm256_set1_epi32(7));
+    }
+
+    balance_change = _mm256_cvtsi256_si32(running_change);
+    StoreMinMax(mins, maxes, min_balance, max_balance);
+    return d;
+}
+#endif
+
+//The balance updates are compiled for a few bounds on the horizon, so that the
+//changes by distance can live on the stack.  Horizons over the largest bound use
+//balance_changes_ instead.
 void GameTimeline::UpdateBalances(const int depth) {
+    switch (max_horizon_) {
+        case 32: this->UpdateAllBalances<32>();   break;
+        case 48: this->UpdateAllBalances<48>();   break;
+        case 64: this->UpdateAllBalances<64>();   break;
+        default: this->UpdateAllBalances<0>();    break;
+    }
+}
+
+void GameTimeline::UpdateBalances(const PlanetTimelineList& modified_planets, const int depth) {
+    switch (max_horizon_) {
+        case 32: this->UpdateChangedBalances<32>(modified_planets);   break;
+        case 48: this->UpdateChangedBalances<48>(modified_planets);   break;
+        case 64: this->UpdateChangedBalances<64>(modified_planets);   break;
+        default: this->UpdateChangedBalances<0>(modified_planets);    break;
+    }
+}
+
+int GameTimeline::MaxHorizonFor(const int horizon) {
+    const int kMaxHorizons[] = {32, 48, 64};
+
+    for (uint i = 0; i < sizeof(kMaxHorizons) / sizeof(kMaxHorizons[0]); ++i) {
+        //The updates use the changes up to distance horizon + 1.
+        if (horizon + 2 <= kMaxHorizons[i]) {
+            return kMaxHorizons[i];
+        }
+    }
+
+    return 0;
+}
+
+template <int kMaxHorizon>
+void GameTimeline::UpdateAllBalances() {
     //Calculate the strategic balances at each turn for each planet.
     //A strategic balance for turn t and distance d is the sum of my ships that can reach the planet
     //at t departing after turn (t-d) minus the enemy ships that can reach the planet on turn t 
     //departing on or after turn (t-d).
     //Positive balances are good; negative balances are bad.
+    //
+    //Each source adds its ships to all balances from some distance d onwards.  Instead
+    //of adding them to each of those balances, record the change at the first d, and
+    //then find all of the turn's balances, along with their minimum and maximum, in
+    //a single sweep over d.
     const std::vector<int>& when_is_feeder_allowed_to_attack = *when_is_feeder_allowed_to_attack_;
     const int num_planets = game_->NumPlanets();
+    int bounded_balance_changes[kMaxHorizon > 0 ? kMaxHorizon : 1];
+    int* balance_changes = bounded_balance_changes;
+
+    if (0 == kMaxHorizon) {
+        balance_changes_.resize(horizon_ + 1);
+        balance_changes = &balance_changes_[0];
+    }
 
     for (uint i = 0; i < planet_timelines_.size(); ++i) {
         PlanetTimeline* planet = planet_timelines_[i];
         PlanetTimelineList planets_by_distance = this->TimelinesByDistance(planet);
-        std::vector<int>& balances = planet->Balances();
+        this->JournalBalances(i);
+        int* balances = planet->Balances();
         int first_negative_min_balance = horizon_;
         int first_positive_max_balance = horizon_;
         int total_negative_min_balance = 0;
@@ -455,7 +812,7 @@ void GameTimeline::UpdateBalances(const int depth) {
             int max_balance = starting_balance;
            
             for (int d = 1; d <= t; ++d) {
-                balances[offset + d] = starting_balance;
+                balance_changes[d] = 0;
             }
 
             //Calculate the neighbours' contributions to the balances.
@@ -485,21 +842,36 @@ void GameTimeline::UpdateBalances(const int depth) {
                 const int ships_from_source = OwnerMultiplier(owner) * ships;
                 const int first_d = distance_to_source + (kMe == owner ? 1 : 0);
 
-                for (int d = first_d; d <= t; ++d) {
-                    balances[offset + d] += ships_from_source;
+                if (first_d <= t) {
+                    balance_changes[first_d] += ships_from_source;
                 }
             }
 
-            //Calculate the summaries.
-            for (int d = first_source_distance; d <= t; ++d) {
-                const int index = offset + d;
+            //Calculate the balances and their summaries.
+            int balance = starting_balance;
+            int d = 1;
 
-                if (min_balance > balances[index]) {
-                    min_balance = balances[index];
+#ifdef WITH_AVX2_BALANCES
+            if (kHasAvx2) {
+                d = WriteBalancesAvx2(balances, offset, d, t, balance_changes,
+                    first_source_distance, balance, min_balance, max_balance);
+            }
+#endif
+
+            for (; d <= t; ++d) {
+                balance += balance_changes[d];
+                balances[offset + d] = balance;
+
+                if (d < first_source_distance) {
+                    continue;
                 }
 
-                if (max_balance < balances[index]) {
-                    max_balance = balances[index];
+                if (min_balance > balance) {
+                    min_balance = balance;
+                }
+
+                if (max_balance < balance) {
+                    max_balance = balance;
                 }
             }
 
@@ -524,6 +896,7 @@ void GameTimeline::UpdateBalances(const int depth) {
         planet->SetFirstNegativeMinBalanceTurn(first_negative_min_balance);
         planet->SetFirstPositiveMaxBalanceTurn(first_positive_max_balance);
         planet->SetTotalNegativeMinBalance(-total_negative_min_balance);
+        planet->SetBalancesUpToDate(true);
     }
 
     //Update the timelines' ships gained.
@@ -532,21 +905,69 @@ void GameTimeline::UpdateBalances(const int depth) {
     }
 }
 
-void GameTimeline::UpdateBalances(const PlanetTimelineList& modified_planets, const int depth) {
+template <int kMaxHorizon>
+void GameTimeline::UpdateChangedBalances(const PlanetTimelineList& modified_planets) {
     //Update balances.  Update only the effects of the planets whose timelines have been changed.
+    //Rather than going through every source of every planet, go through the planets that each
+    //modified source can reach, and recalculate only the balances that have changed.
     const std::vector<int>& when_is_feeder_allowed_to_attack = *when_is_feeder_allowed_to_attack_;
     const int num_planets = game_->NumPlanets();
+    int bounded_balance_changes[kMaxHorizon > 0 ? kMaxHorizon : 1];
+    int* balance_changes = bounded_balance_changes;
+
+    if (0 == kMaxHorizon) {
+        balance_changes_.assign(horizon_ + 2, 0);
+        balance_changes = &balance_changes_[0];
+
+    } else {
+        std::fill(bounded_balance_changes, bounded_balance_changes + kMaxHorizon, 0);
+    }
+
+    //Skip repeated planets in the list of modified ones.
+    PlanetTimelineList& sources = modified_sources_;
+    sources.clear();
+
+    for (uint j = 0; j < modified_planets.size(); ++j) {
+        PlanetTimeline* source = modified_planets[j];
+
+        if (std::find(sources.begin(), sources.end(), source) == sources.end()) {
+            sources.push_back(source);
+        }
+    }
 
     for (uint i = 0; i < planet_timelines_.size(); ++i) {
         PlanetTimeline* planet = planet_timelines_[i];
         PlanetTimeline* base_planet = base_planet_timelines_[i];
-        PlanetTimelineList planets_by_distance = this->TimelinesByDistance(planet);
-        std::vector<int>& balances = planet->Balances();
-        int first_negative_min_balance = horizon_;
-        int first_positive_max_balance = horizon_;
-        int total_negative_min_balance = 0;
-        const int first_source_distance = game_->GetDistance(planets_by_distance[0]->Id(), planet->Id());
-        const int first_t = first_source_distance;
+        const int planet_id = planet->Id();
+
+        //The balances of a planet whose own timeline has changed need to be updated at every
+        //turn.  Otherwise, only the turns affected by the modified sources are updated.
+        const bool is_planet_modified = 
+            are_working_timelines_different_[planet_id] || !planet->AreBalancesUpToDate();
+        
+        //Find the modified sources that can reach this planet, and the closest planet.
+        PlanetTimelineList& nearby_sources = nearby_sources_;
+        std::vector<int>& distances_to_sources = distances_to_sources_;
+        nearby_sources.clear();
+        distances_to_sources.clear();
+        int first_source_distance = horizon_;
+
+        for (int j = 0; j < num_planets; ++j) {
+            if (j != planet_id) {
+                first_source_distance = std::min(first_source_distance, game_->GetDistance(j, planet_id));
+            }
+        }
+
+        for (uint j = 0; j < sources.size(); ++j) {
+            PlanetTimeline* source = sources[j];
+
+            if (source != planet) {
+                nearby_sources.push_back(source);
+                distances_to_sources.push_back(game_->GetDistance(source->Id(), planet_id));
+            }
+        }
+
+        int* balances = NULL;
 
 #ifndef IS_SUBMISSION
         const int id = planet->Id();
@@ -564,46 +985,27 @@ void GameTimeline::UpdateBalances(const PlanetTimelineList& modified_planets, co
             const int starting_balance = planet->ShipsAt(t) * (planet_owner == kMe ? 1 : -1);
             const int base_planet_owner = base_planet->OwnerAt(t);
             const int base_prev_planet_owner = base_planet->OwnerAt(t - 1);
-            const int base_starting_balance = base_planet->ShipsAt(t) * (base_planet_owner == kMe ? 1 : -1);
-
             const int neutral_adjustment = planet->NeutralBalanceAdjustment(t);
-            const int base_neutral_adjustment = base_planet->NeutralBalanceAdjustment(t);
-            const int neutral_adjustment_change = neutral_adjustment - base_neutral_adjustment;
-
-            const int starting_balance_diff = starting_balance - base_starting_balance + neutral_adjustment_change;
+            int starting_balance_diff = 0;
 
-
-            const int offset = t * (t - 1) / 2 - 1;
-            int min_balance = starting_balance;
-            int max_balance = starting_balance;
-            
-            if (starting_balance_diff != 0) {
-                for (int d = 1; d <= t; ++d) {
-                    balances[offset + d] += starting_balance_diff;
-                }
+            if (is_planet_modified) {
+                const int base_starting_balance = base_planet->ShipsAt(t) * (base_planet_owner == kMe ? 1 : -1);
+                const int base_neutral_adjustment = base_planet->NeutralBalanceAdjustment(t);
+                const int neutral_adjustment_change = neutral_adjustment - base_neutral_adjustment;
+                starting_balance_diff = starting_balance - base_starting_balance + neutral_adjustment_change;
             }
 
-            //Calculate the neighbours' contributions to the balances.
-            for (uint s = 0; s < planets_by_distance.size(); ++s) {
-                PlanetTimeline* source = planets_by_distance[s];
-                const int source_id = source->Id();
-                
-                const int distance_to_source = game_->GetDistance(source->Id(), planet->Id());
+            //The summaries start from the unadjusted starting balance, so they need to be
+            //redone wherever there is a neutral adjustment.
+            bool has_turn_changed = is_planet_modified || (0 != neutral_adjustment);
+
+            //Calculate how the modified neighbours' contributions have changed.  Record the
+            //changes at the distance where they start.
+            for (uint s = 0; s < nearby_sources.size(); ++s) {
+                PlanetTimeline* source = nearby_sources[s];
+                const int distance_to_source = distances_to_sources[s];
                 
                 if (distance_to_source > t) {
-                    break;
-                }
-
-                //Use only the sources from the provided list.
-                bool found_source = false;
-                for (uint j = 0; j < modified_planets.size(); ++j) {
-                    if (modified_planets[j]->Id() == source_id) {
-                        found_source = true;
-                        break;
-                    }
-                }
-
-                if (!found_source) {
                     continue;
                 }
 
@@ -616,16 +1018,13 @@ void GameTimeline::UpdateBalances(const PlanetTimelineList& modified_planets, co
 
                 if (source->IsReinforcer() && (planet_owner == kEnemy || base_planet_owner == kEnemy)) {
                     //Feeder planets aren't allowed to attack enemies unless explicitly allowed.
-                    const int attack_permission_index = num_planets * source->Id() + planet->Id();
+                    const int attack_permission_index = num_planets * source->Id() + planet_id;
 
                     if (when_is_feeder_allowed_to_attack[attack_permission_index] != (t - distance_to_source)) {
                         if (base_planet_owner == kEnemy && base_prev_planet_owner != kMe) base_source_effect = 0;
                         if (planet_owner == kEnemy && prev_planet_owner != kMe) source_effect = 0;
                     }
                 }
-                //if (source->IsReinforcer()) {
-                //    continue;
-                //}
 
                 const int ships = source->ShipsFree(t - distance_to_source, owner);
                 const int ships_from_source = OwnerMultiplier(owner) * ships * source_effect;
@@ -640,21 +1039,53 @@ void GameTimeline::UpdateBalances(const PlanetTimelineList& modified_planets, co
                     const int multiplier = (kMe == owner ? 0 : 1);
                     const int base_multiplier = (kMe == base_owner ? 0 : 1);
                     const int change = ships_from_source * multiplier - base_ships_from_source * base_multiplier;
-                    balances[offset + distance_to_source] += change;
-                }
 
-                if (0 == balance_change) {
-                    continue;
+                    if (0 != change) {
+                        balance_changes[distance_to_source] += change;
+                        balance_changes[distance_to_source + 1] -= change;
+                        has_turn_changed = true;
+                    }
                 }
 
-                for (int d = first_d; d <= t; ++d) {
-                    balances[offset + d] += balance_change;
+                if (0 != balance_change && first_d <= t) {
+                    balance_changes[first_d] += balance_change;
+                    has_turn_changed = true;
                 }
             }
 
-            //Calculate the summaries.
-            for (int d = first_source_distance; d <= t; ++d) {
+            if (!has_turn_changed) {
+                continue;
+            }
+
+            if (NULL == balances) {
+                this->JournalBalances(i);
+                balances = planet->Balances();
+            }
+
+            //Apply the changes, and recalculate the summaries.
+            const int offset = t * (t - 1) / 2 - 1;
+            int min_balance = starting_balance;
+            int max_balance = starting_balance;
+            int balance_change = starting_balance_diff;
+            int d = 1;
+
+#ifdef WITH_AVX2_BALANCES
+            if (kHasAvx2) {
+                d = AddToBalancesAvx2(balances, offset, d, t, balance_changes,
+                    first_source_distance, balance_change, min_balance, max_balance);
+            }
+#endif
+
+            for (; d <= t; ++d) {
+                balance_change += balance_changes[d];
+                balance_changes[d] = 0;
+
                 const int index = offset + d;
+                balances[index] += balance_change;
+
+                if (d < first_source_distance) {
+                    continue;
+                }
 
                 if (min_balance > balances[index]) {
                     min_balance = balances[index];
@@ -665,9 +1096,26 @@ void GameTimeline::UpdateBalances(const PlanetTimelineList& modified_planets, co
                 }
             }
 
+            balance_changes[t + 1] = 0;
+
             //Update min/max balances at each turn.
             planet->SetMinBalanceAt(t, min_balance);
             planet->SetMaxBalanceAt(t, max_balance);
+        }
+
+        if (NULL == balances) {
+            //Nothing has changed for this planet.
+            continue;
+        }
+
+        //Update the planet's balance summaries.
+        int first_negative_min_balance = horizon_;
+        int first_positive_max_balance = horizon_;
+        int total_negative_min_balance = 0;
+
+        for (int t = 1; t < horizon_; ++t) {
+            const int min_balance = planet->MinBalanceAt(t);
+            const int max_balance = planet->MaxBalanceAt(t);
 
             if (min_balance < 0 && first_negative_min_balance == horizon_) {
                 first_negative_min_balance = t;
@@ -680,24 +1128,41 @@ void GameTimeline::UpdateBalances(const PlanetTimelineList& modified_planets, co
             if (min_balance < 0) {
                 total_negative_min_balance += min_balance;
             }
-
         }
 
         planet->SetFirstNegativeMinBalanceTurn(first_negative_min_balance);
         planet->SetFirstPositiveMaxBalanceTurn(first_positive_max_balance);
         planet->SetTotalNegativeMinBalance(-total_negative_min_balance);
-    }
-    
-    //Update the timelines' ships gained.
-    for (uint i = 0; i < planet_timelines_.size(); ++i) {
-        planet_timelines_[i]->RecalculateShipsGained();
+        planet->SetBalancesUpToDate(true);
+
+        //Update the timeline's ships gained.
+        planet->RecalculateShipsGained();
     }
 }
 
 #ifndef IS_SUBMISSION
+//Compare the fingerprints, and every so often the whole timelines too, to catch
+//differences that the fingerprints miss.  WITH_FULL_TIMELINE_CHECKS compares
+//the whole timelines every time.
 void GameTimeline::AssertWorkingTimelinesAreEqualToBase() {
+#ifdef WITH_FULL_TIMELINE_CHECKS
+    const int kFullCheckPeriod = 1;
+#else
+    const int kFullCheckPeriod = 64;
+#endif
+
+    ++num_checks_since_full_check_;
+    const bool is_full_check = (num_checks_since_full_check_ >= kFullCheckPeriod);
+
+    if (is_full_check) {
+        num_checks_since_full_check_ = 0;
+    }
+
     for (uint i = 0; i < planet_timelines_.size(); ++i) {
-        pw_assert(planet_timelines_[i]->Equals(base_planet_timelines_[i]) && "Working Timelines are different from base.");
+        pw_assert(planet_timelines_[i]->Fingerprint() == base_planet_timelines_[i]->Fingerprint()
+            && "Working Timelines are different from base.");
+        pw_assert((!is_full_check || planet_timelines_[i]->Equals(base_planet_timelines_[i]))
+            && "Working Timelines are different from base.");
     }
 }
 #endif
@@ -706,7 +1171,56 @@ void GameTimeline::AssertWorkingTimelinesAreEqualToBase() {
                PlanetTimeline class
 ************************************************/
 PlanetTimeline::PlanetTimeline()
-:game_(NULL), planet_(NULL), is_reinforcer_(false), is_recalculating_(false) {
+:arrays_(NULL), arrays_size_(0), are_balances_up_to_date_(false), game_(NULL), planet_(NULL), is_reinforcer_(false), is_recalculating_(false) {
+}
+
+void PlanetTimeline::AllocateArrays(const int horizon) {
+    //Each array is padded to a whole number of cache lines.
+    const int kCacheLineSize = 64;
+    const int kIntsPerCacheLine = kCacheLineSize / sizeof(int);
+    const int kNumArrays = 22;
+    const int stride = (horizon + kIntsPerCacheLine - 1) / kIntsPerCacheLine * kIntsPerCacheLine;
+    const int num_balances = horizon * (horizon + 1) / 2;
+    
+    arrays_size_ = kNumArrays * stride + num_balances;
+    array_storage_.assign(arrays_size_ + kIntsPerCacheLine - 1, 0);
+
+    //Align the start of the block on a cache line.
+    const size_t misalignment = reinterpret_cast<size_t>(&array_storage_[0]) % kCacheLineSize;
+    arrays_ = &array_storage_[0] + (0 == misalignment ? 0 : (kCacheLineSize - misalignment) / sizeof(int));
+
+    int* next_array = arrays_;
+    owner_ = next_array;                        next_array += stride;
+    ships_ = next_array;                        next_array += stride;
+    my_arrivals_ = next_array;                  next_array += stride;
+    enemy_arrivals_ = next_array;               next_array += stride;
+    ships_to_take_over_ = next_array;           next_array += stride;
+    ships_gained_ = next_array;                 next_array += stride;
+    available_growth_ = next_array;             next_array += stride;
+    ships_reserved_ = next_array;               next_array += stride;
+    ships_free_ = next_array;                   next_array += stride;
+
+    enemy_ships_to_take_over_ = next_array;     next_array += stride;
+    enemy_ships_reserved_ = next_array;         next_array += stride;
+    enemy_ships_free_ = next_array;             next_array += stride;
+    enemy_available_growth_ = next_array;       next_array += stride;
+
+    my_departures_ = next_array;                next_array += stride;
+    enemy_departures_ = next_array;             next_array += stride;
+
+    my_unreserved_arrivals_ = next_array;       next_array += stride;
+    my_contingent_departures_ = next_array;     next_array += stride;
+    enemy_contingent_departures_ = next_array;  next_array += stride;
+
+    my_reservations_ = next_array;              next_array += stride;
+    enemy_reservations_ = next_array;           next_array += stride;
+
+    //Keep the balances last, so that CopyBalances() can copy them in one go.
+    min_balances_ = next_array;                 next_array += stride;
+    max_balances_ = next_array;                 next_array += stride;
+    balances_ = next_array;
+
+    pw_assert(balances_ + num_balances == arrays_ + arrays_size_);
 }
 
 void PlanetTimeline::Initialize(int forecast_horizon, Planet *planet, GameMap *game, GameTimeline* game_timeline) {
@@ -720,32 +1234,12 @@ void PlanetTimeline::Initialize(int forecast_horizon, Planet *planet, GameMap *g
     const int growth_rate = planet->GrowthRate();
 
     id_ = planet->Id();
-    owner_.resize(u_horizon, 0);
-    ships_.resize(u_horizon, 0);
-    my_arrivals_.resize(u_horizon, 0);
-    enemy_arrivals_.resize(u_horizon, 0);
-    ships_to_take_over_.resize(u_horizon, 0);
-    ships_gained_.resize(u_horizon, 0);
-    available_growth_.resize(u_horizon, growth_rate);
-    ships_reserved_.resize(u_horizon, 0);
-    ships_free_.resize(u_horizon, 0);
-
-    enemy_ships_to_take_over_.resize(u_horizon, 0);
-    enemy_ships_reserved_.resize(u_horizon, 0);
-    enemy_ships_free_.resize(u_horizon, 0);
-    enemy_available_growth_.resize(u_horizon, growth_rate);
-
-    my_departures_.resize(u_horizon, 0);
-    enemy_departures_.resize(u_horizon, 0);
-
-    my_unreserved_arrivals_.resize(u_horizon, 0);
-
-    my_contingent_departures_.resize(u_horizon, 0);
-    enemy_contingent_departures_.resize(u_horizon, 0);
-    
-    balances_.resize(u_horizon*(u_horizon + 1)/2, 0);
-    min_balances_.resize(u_horizon, 0);
-    max_balances_.resize(u_horizon, 0);
+    this->AllocateArrays(horizon_);
+
+    for (int t = 0; t < horizon_; ++t) {
+        available_growth_[t] = growth_rate;
+        enemy_available_growth_[t] = growth_rate;
+    }
     
     will_not_be_mine_ = false;
 	will_be_mine_ = false;
@@ -754,7 +1248,7 @@ void PlanetTimeline::Initialize(int forecast_horizon, Planet *planet, GameMap *g
     additional_arrivals_.resize(u_horizon, 0);
 
     //Find out when various ships will be arriving.
-    FleetList arrivingFleets = game->FleetsArrivingAt(planet);
+    const FleetList& arrivingFleets = game->FleetsArrivingAt(planet);
     
     for (unsigned int i = 0; i < arrivingFleets.size(); ++i) {
         Fleet* fleet = arrivingFleets[i];
@@ -781,6 +1275,8 @@ void PlanetTimeline::Initialize(int forecast_horizon, Planet *planet, GameMap *g
     will_be_enemys_ = (kEnemy == starting_owner);
 
     is_recalculating_ = false;
+    earliest_change_ = horizon_;
+    fingerprint_ = this->ComputeFingerprint();
 
     this->RecalculateTimeline(1);
 }
@@ -792,45 +1288,30 @@ void PlanetTimeline::Copy(PlanetTimeline* other) {
     game_ = other->game_;
     planet_ = other->planet_;
     game_timeline_ = other->game_timeline_;
+
+    if (arrays_size_ != other->arrays_size_) {
+        this->AllocateArrays(horizon_);
+        additional_arrivals_.resize(static_cast<size_t>(horizon_), 0);
+    }
     
     this->CopyTimeline(other);
 }
 
 void PlanetTimeline::CopyTimeline(PlanetTimeline* other) {
-    owner_ = other->owner_;
-    ships_ = other->ships_;
-    my_arrivals_ = other->my_arrivals_;
-    enemy_arrivals_ = other->enemy_arrivals_;
-    ships_to_take_over_ = other->ships_to_take_over_;
-    ships_gained_ = other->ships_gained_;
-    available_growth_ = other->available_growth_;
-    ships_reserved_ = other->ships_reserved_;
-    ships_free_ = other->ships_free_;
-
-    enemy_ships_to_take_over_ = other->enemy_ships_to_take_over_;
-    enemy_ships_reserved_ = other->enemy_ships_reserved_;
-    enemy_ships_free_ = other->enemy_ships_free_;
-    enemy_available_growth_ = other->enemy_available_growth_;
-    
-    my_departures_ = other->my_departures_;
-    enemy_departures_ = other->enemy_departures_;
-
-    my_unreserved_arrivals_ = other->my_unreserved_arrivals_;
-
-    my_contingent_departures_ = other->my_contingent_departures_;
-    enemy_contingent_departures_ = other->enemy_contingent_departures_;
+    pw_assert(arrays_size_ == other->arrays_size_);
+    memcpy(arrays_, other->arrays_, arrays_size_ * sizeof(int));
 
     total_ships_gained_ = other->total_ships_gained_;
+    earliest_change_ = other->earliest_change_;
+    fingerprint_ = other->fingerprint_;
 
     departing_actions_ = other->departing_actions_;
 
-    balances_ = other->balances_;
-    min_balances_ = other->min_balances_;
-    max_balances_ = other->max_balances_;
     first_negative_min_balance_turn_ = other->first_negative_min_balance_turn_;
     first_positive_max_balance_turn_ = other->first_positive_max_balance_turn_;
     total_negative_min_balance_ = other->total_negative_min_balance_;
     has_balance_changed_fate_ = other->has_balance_changed_fate_;
+    are_balances_up_to_date_ = other->are_balances_up_to_date_;
 
     will_not_be_enemys_ = other->will_not_be_enemys_;
     will_not_be_mine_ = other->will_not_be_mine_;
@@ -841,13 +1322,13 @@ void PlanetTimeline::CopyTimeline(PlanetTimeline* other) {
 }
 
 void PlanetTimeline::CopyBalances(PlanetTimeline* other) {
-    balances_ = other->balances_;
-    min_balances_ = other->min_balances_;
-    max_balances_ = other->max_balances_;
+    const int balances_offset = static_cast<int>(min_balances_ - arrays_);
+    memcpy(min_balances_, other->min_balances_, (arrays_size_ - balances_offset) * sizeof(int));
     first_negative_min_balance_turn_ = other->first_negative_min_balance_turn_;
     first_positive_max_balance_turn_ = other->first_positive_max_balance_turn_;
     total_negative_min_balance_ = other->total_negative_min_balance_;
     total_ships_gained_ = other->total_ships_gained_;
+    are_balances_up_to_date_ = other->are_balances_up_to_date_;
 }
 
 bool PlanetTimeline::Equals(PlanetTimeline* other) const {
@@ -881,6 +1362,8 @@ bool PlanetTimeline::Equals(PlanetTimeline* other) const {
         are_equal &= (my_unreserved_arrivals_[t] == other->my_unreserved_arrivals_[t]);
         are_equal &= (my_contingent_departures_[t] == other->my_contingent_departures_[t]);
         are_equal &= (enemy_contingent_departures_[t] == other->enemy_contingent_departures_[t]);
+        are_equal &= (my_reservations_[t] == other->my_reservations_[t]);
+        are_equal &= (enemy_reservations_[t] == other->enemy_reservations_[t]);
 
         //Strategic balances.
         are_equal &= (min_balances_[t] == other->min_balances_[t]);
@@ -901,7 +1384,9 @@ bool PlanetTimeline::Equals(PlanetTimeline* other) const {
         }
     }
 
-    for (uint i = 0; i < balances_.size(); ++i) {
+    const int num_balances = horizon_ * (horizon_ + 1) / 2;
+
+    for (int i = 0; i < num_balances; ++i) {
         if (balances_[i] != other->balances_[i]) {
             return false;
         }
@@ -912,6 +1397,7 @@ bool PlanetTimeline::Equals(PlanetTimeline* other) const {
     are_equal &= (first_positive_max_balance_turn_ == other->first_positive_max_balance_turn_);
     are_equal &= (total_negative_min_balance_ == other->total_negative_min_balance_);
     are_equal &= (has_balance_changed_fate_ == other->has_balance_changed_fate_);
+    are_equal &= (are_balances_up_to_date_ == other->are_balances_up_to_date_);
 
     are_equal &= (will_not_be_enemys_ == other->will_not_be_enemys_);
     are_equal &= (will_not_be_mine_ == other->will_not_be_mine_);
@@ -937,6 +1423,11 @@ void PlanetTimeline::Update() {
     //Advance the forecast frame through time.
     is_reinforcer_ = false;
 
+    if (this->IsForecastStillValid()) {
+        this->ShiftForecast();
+        return;
+    }
+
     //Reset the various arrays.
     //For now deal only with my arrivals.
     for (uint i = 0; i < additional_arrivals_.size(); ++i) {
@@ -954,10 +1445,12 @@ void PlanetTimeline::Update() {
         my_unreserved_arrivals_[i] = 0;
         my_contingent_departures_[i] = 0;
         enemy_contingent_departures_[i] = 0;
+        my_reservations_[i] = 0;
+        enemy_reservations_[i] = 0;
     }
 
     //Update the fleet arrivals.
-    FleetList arrivingFleets = game_->FleetsArrivingAt(planet_);
+    const FleetList& arrivingFleets = game_->FleetsArrivingAt(planet_);
     
     for (unsigned int i = 0; i < arrivingFleets.size(); ++i) {
         Fleet* fleet = arrivingFleets[i];
@@ -988,10 +1481,79 @@ void PlanetTimeline::Update() {
     will_be_mine_ = (kMe == current_owner);
     will_not_be_enemys_ = (kEnemy != current_owner);
     will_be_enemys_ = (kEnemy == current_owner);
+    fingerprint_ = this->ComputeFingerprint();
 
     this->RecalculateTimeline(1);
 }
 
+bool PlanetTimeline::IsForecastStillValid() const {
+    if (!game_->FleetsArrivingAt(planet_).empty()
+        || planet_->Owner() != owner_[1] || planet_->NumShips() != ships_[1]) {
+        return false;
+    }
+
+    //Without any arrivals or departures, the forecast is plain growth.
+    for (int i = 1; i < horizon_; ++i) {
+        const int activity = my_arrivals_[i] | enemy_arrivals_[i] | my_departures_[i] | enemy_departures_[i]
+            | my_contingent_departures_[i] | enemy_contingent_departures_[i] | my_unreserved_arrivals_[i]
+            | ships_reserved_[i] | enemy_ships_reserved_[i];
+
+        if (0 != activity) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void PlanetTimeline::ShiftForecast() {
+    //Move every turn one step closer.  The arrivals, departures and reservations
+    //are all zero and stay that way.
+    int* const shifted_arrays[] = {owner_, ships_, ships_to_take_over_, ships_gained_, available_growth_,
+        enemy_ships_to_take_over_, enemy_available_growth_};
+    const int num_shifted_arrays = sizeof(shifted_arrays) / sizeof(shifted_arrays[0]);
+    const size_t shifted_size = (horizon_ - 1) * sizeof(int);
+
+    //Like Update(), keep the enemy's ships to take over now from before.
+    const int enemy_ships_to_take_over_now = enemy_ships_to_take_over_[0];
+
+    for (int i = 0; i < num_shifted_arrays; ++i) {
+        memmove(shifted_arrays[i], shifted_arrays[i] + 1, shifted_size);
+    }
+
+    enemy_ships_to_take_over_[0] = enemy_ships_to_take_over_now;
+
+    //Set up the current turn exactly as Update() does.
+    const int current_owner = planet_->Owner();
+    ships_to_take_over_[0] = 0;
+    available_growth_[0] = 0;
+    enemy_available_growth_[0] = 0;
+    ships_reserved_[0] = 0;
+    enemy_ships_reserved_[0] = 0;
+    my_departures_[0] = 0;
+    enemy_departures_[0] = 0;
+    my_arrivals_[0] = 0;
+    enemy_arrivals_[0] = 0;
+    my_unreserved_arrivals_[0] = 0;
+    my_contingent_departures_[0] = 0;
+    enemy_contingent_departures_[0] = 0;
+    my_reservations_[0] = 0;
+    enemy_reservations_[0] = 0;
+
+    departing_actions_.clear();
+
+    ships_gained_[0] = planet_->GrowthRate() * OwnerMultiplier(current_owner);
+    will_not_be_mine_ = (kMe != current_owner);
+    will_be_mine_ = (kMe == current_owner);
+    will_not_be_enemys_ = (kEnemy != current_owner);
+    will_be_enemys_ = (kEnemy == current_owner);
+
+    fingerprint_ = this->ComputeFingerprint();
+
+    //Only the last turn is new.
+    this->RecalculateTimeline(horizon_ - 1);
+}
+
 int PlanetTimeline::ShipsGainedForActions(const ActionList& actions) const {
     if (actions.empty()) {
         return 0;
@@ -1115,6 +1677,35 @@ bool PlanetTimeline::WillNotBeOwnedBy(int owner) const {
 }
 
 void PlanetTimeline::AddDeparture(Action *action) {
+    //Make sure that the right number of ships exists on the planet.
+    pw_assert(action->IsContingent() || action->NumShips() <= ships_[action->DepartureTime()]);
+
+    if (this->RecordDeparture(action)) {
+        this->RecalculateAfterChanges();
+    }
+}
+
+void PlanetTimeline::AddArrivals(const ActionList& actions) {
+    if (this->RecordArrivals(actions) && !is_recalculating_) {
+        this->RecalculateAfterChanges();
+    }
+}
+
+void PlanetTimeline::RecalculateAfterChanges() {
+    if (earliest_change_ <= 1) {
+        this->ResetStartingData();
+        this->RecalculateTimeline(1);
+
+    } else {
+        const int starting_at = earliest_change_;
+        this->PrepareToRecalculateFrom(starting_at);
+        this->RecalculateTimeline(starting_at);
+    }
+}
+
+bool PlanetTimeline::RecordDeparture(Action *action) {
+    game_timeline_->JournalTimeline(id_);
+
     const int num_ships = action->NumShips();
     const int departure_time = action->DepartureTime();
     const int growth_rate = planet_->GrowthRate();
@@ -1128,9 +1719,8 @@ void PlanetTimeline::AddDeparture(Action *action) {
 
     departing_actions_.push_back(action);
 
-    std::vector<int>& departures = (action_owner == kMe ? my_departures_ : enemy_departures_);
-    std::vector<int>& ships_free = (action_owner == kMe ? ships_free_ : enemy_ships_free_);
-    std::vector<int>& contingent_departures = (action_owner == kMe ? my_contingent_departures_ : enemy_contingent_departures_);
+    int* departures = (action_owner == kMe ? my_departures_ : enemy_departures_);
+    int* contingent_departures = (action_owner == kMe ? my_contingent_departures_ : enemy_contingent_departures_);
 
 #ifndef IS_SUBMISSION
     if (21 == id_ && 28 == num_ships && departure_time == 28) {
@@ -1141,28 +1731,28 @@ void PlanetTimeline::AddDeparture(Action *action) {
     //In case of contingent departures (i.e. departures that only happen in response to certain
     //opponent actions), reserve ships but don't subtract them from the planet.
     if (action->IsContingent()) {
-        contingent_departures[departure_time] += num_ships;
+        this->AddToInput(contingent_departures, departure_time, num_ships);
         this->ReserveShips(action_owner, departure_time, num_ships);
-        return;
+        this->UpdateShipsFree(departure_time);
+        return false;
     }
     
-    //Make sure that the right number of ships exists on the planet.
-    pw_assert(num_ships <= ships_[departure_time]);
-
     //Record the departure.
-    departures[departure_time] += num_ships;
-    this->ResetStartingData();
-    this->RecalculateTimeline(1);
+    this->AddToInput(departures, departure_time, num_ships);
+    earliest_change_ = std::min(earliest_change_, departure_time);
+    return true;
 }
 
-void PlanetTimeline::AddArrivals(const ActionList& actions) {
+bool PlanetTimeline::RecordArrivals(const ActionList& actions) {
     if (actions.empty()) {
-        return;
+        return false;
     }
+
+    game_timeline_->JournalTimeline(id_);
     
     //Add arrivals to the planet's timeline.
     const int action_owner = actions[0]->Owner();
-    std::vector<int>& arrivals = (kMe == action_owner ? my_arrivals_ : enemy_arrivals_);
+    int* arrivals = (kMe == action_owner ? my_arrivals_ : enemy_arrivals_);
     int earliest_arrival = horizon_;
     
     for (uint i = 0; i < actions.size(); ++i) {
@@ -1172,11 +1762,11 @@ void PlanetTimeline::AddArrivals(const ActionList& actions) {
         const int arrival_time = action->DepartureTime() + action->Distance();
         
         pw_assert(arrival_time < horizon_ && "In PlanetTimeline::AddArrivals");
-        arrivals[arrival_time] += action->NumShips();
+        this->AddToInput(arrivals, arrival_time, action->NumShips());
 
 #ifndef ENEMY_RESERVES_SHIPS_AGAINST_ARRIVALS
         if (kMe == action_owner) {
-            my_unreserved_arrivals_[arrival_time] += action->NumShips();
+            this->AddToInput(my_unreserved_arrivals_, arrival_time, action->NumShips());
         }
 #endif
     
@@ -1185,49 +1775,53 @@ void PlanetTimeline::AddArrivals(const ActionList& actions) {
         }
     }
 
-    if (!is_recalculating_) {
-        this->ResetStartingData();
-        this->RecalculateTimeline(1);
-    }
+    earliest_change_ = std::min(earliest_change_, earliest_arrival);
+    return true;
 }
 
 void PlanetTimeline::RemoveArrival(Action *action) {
+    game_timeline_->JournalTimeline(id_);
+
     const int departure_time = action->DepartureTime();
     const int distance = action->Distance();
     const int arrival_time = departure_time + distance;
     const int num_ships = action->NumShips();
 
-    std::vector<int>& arrivals = (kMe == action->Owner() ? my_arrivals_ : enemy_arrivals_);
+    int* arrivals = (kMe == action->Owner() ? my_arrivals_ : enemy_arrivals_);
     pw_assert(num_ships <= arrivals[arrival_time]);
-    arrivals[arrival_time] -= num_ships;
+    this->AddToInput(arrivals, arrival_time, -num_ships);
 
     if (kMe == action->Owner()) {
-        my_unreserved_arrivals_[arrival_time] -= num_ships;
+        this->AddToInput(my_unreserved_arrivals_, arrival_time, -num_ships);
     }
     
-    this->ResetStartingData();
-    this->RecalculateTimeline(1);
+    earliest_change_ = std::min(earliest_change_, arrival_time);
+    this->RecalculateAfterChanges();
 
     this->MarkAsChanged();
 }
 
 void PlanetTimeline::RemoveDeparture(Action *action) {
+    game_timeline_->JournalTimeline(id_);
+
     const int departure_time = action->DepartureTime();
     const int num_ships = action->NumShips();
 
-    std::vector<int>& departures = (kMe == action->Owner() ? my_departures_ : enemy_departures_);
+    int* departures = (kMe == action->Owner() ? my_departures_ : enemy_departures_);
     pw_assert(num_ships <= departures[departure_time]);
-    departures[departure_time] -= num_ships;
+    this->AddToInput(departures, departure_time, -num_ships);
 
     if (!is_recalculating_) {
-        this->ResetStartingData();
-        this->RecalculateTimeline(1);
+        earliest_change_ = std::min(earliest_change_, departure_time);
+        this->RecalculateAfterChanges();
     }
 
     this->MarkAsChanged();
 }
 
 void PlanetTimeline::ResetStartingData() {
+    game_timeline_->JournalTimeline(id_);
+
     const int growth_rate = 0;
 
     //Reset the reservation of ships and ship growths.
@@ -1236,6 +1830,8 @@ void PlanetTimeline::ResetStartingData() {
         enemy_ships_reserved_[i] = 0;
         available_growth_[i] = growth_rate;
         enemy_available_growth_[i] = growth_rate;
+        my_reservations_[i] = 0;
+        enemy_reservations_[i] = 0;
     }
 
     //Reset ownership data.
@@ -1254,16 +1850,16 @@ void PlanetTimeline::ResetStartingData() {
     const int ships_on_surface = ships - departing_ships;
     ships_[0] = ships_on_surface;
     ships_to_take_over_[0] = 0;
-    
-    ships_free_[0] = (kMe == current_owner ? ships_on_surface : 0);
-    enemy_ships_free_[0] = (kEnemy == current_owner ? ships_on_surface : 0);
 
 }
 
 void PlanetTimeline::RecalculateTimeline(int starting_at, const bool use_balances) {
+    game_timeline_->JournalTimeline(id_);
+
     is_recalculating_ = true;
     const int growth_rate = planet_->GrowthRate();
     has_balance_changed_fate_ = false;
+    are_balances_up_to_date_ = false;
     
 #ifndef IS_SUBMISSION
     if (22 == id_ && 0 != my_departures_[17] && 0 == enemy_departures_[17]) {
@@ -1272,6 +1868,15 @@ void PlanetTimeline::RecalculateTimeline(int starting_at, const bool use_balance
 #endif
 
     for (int i = starting_at; i < horizon_; ++i) {
+        //Skip ahead to the next turn with fleets arriving or departing.
+        const int next_event = this->NextEventTurn(i);
+
+        if (next_event > i) {
+            this->FillQuietTurns(i, next_event);
+            i = next_event - 1;
+            continue;
+        }
+
         const int prev_index = i - 1;
         const int prev_owner = owner_[prev_index];
         const int prev_ships = ships_[prev_index];
@@ -1342,21 +1947,13 @@ void PlanetTimeline::RecalculateTimeline(int starting_at, const bool use_balance
         //Update the ownership summaries, additional ship data.
         const int cur_ships = ships_[i];
         const int owner_multiplier = OwnerMultiplier(cur_owner);
-        const int my_multiplier = (kMe == cur_owner ? 1 : 0);
-        const int enemy_multiplier = (kEnemy == cur_owner ? 1 : 0);
         
         will_be_mine_ |= (kMe == cur_owner);
         will_not_be_mine_ |= (kMe != cur_owner);
         will_be_enemys_ |= (kEnemy == cur_owner);
         will_not_be_enemys_ |= (kEnemy != cur_owner);
 
-        ships_free_[i] = std::max(ships_[i] * my_multiplier - ships_reserved_[i], 0);
-        enemy_ships_free_[i] = std::max(ships_[i] * enemy_multiplier - ships_reserved_[i], 0);
-        
-        const int my_total_opponents = std::max(neutral_ships, enemy_ships) - my_ships + (kMe == prev_owner ? 0 : 1);
-        const int enemy_total_opponents = std::max(neutral_ships, my_ships) - enemy_ships + (kEnemy == prev_owner ? 0 : 1);
-        ships_to_take_over_[i] = my_total_opponents * (1 - my_multiplier);
-        enemy_ships_to_take_over_[i] = enemy_total_opponents * (1 - enemy_multiplier);
+        this->SetShipsToTakeOver(i);
 
         ships_gained_[i] = PlanetShipsGainRate(cur_owner, growth_rate);
         available_growth_[i] = (cur_owner == kMe ? growth_rate : 0);
@@ -1372,13 +1969,6 @@ void PlanetTimeline::RecalculateTimeline(int starting_at, const bool use_balance
         }
 
 #ifndef IS_SUBMISSION
-        if (ships_free_[i] > 0) {
-            pw_assert(cur_owner == kMe);
-        } 
-        if (enemy_ships_free_[i] > 0) {
-            pw_assert(cur_owner == kEnemy);
-        }
-
         if (0 == my_arrivals_[i] && 0 == enemy_arrivals_[i]) {
             if (kNeutral != owner_[i]) {
                 pw_assert(ships_[i] == ships_[prev_index] + growth_rate - my_departures_[i] - enemy_departures_[i]);
@@ -1422,15 +2012,141 @@ void PlanetTimeline::RecalculateTimeline(int starting_at, const bool use_balance
     //Tally up the total number of ships gained over the forecast horizon.
     total_ships_gained_ = 0;
 
-    for (unsigned int i = 0; i < ships_gained_.size(); ++i) {
+    for (int i = 0; i < horizon_; ++i) {
         total_ships_gained_ += ships_gained_[i];
     }
 
     total_ships_gained_ += growth_rate * kAdditionalGrowthTurns * OwnerMultiplier(owner_[horizon_ - 1]);
 
+    this->UpdateShipsFree(horizon_);
+
+    earliest_change_ = horizon_;
     is_recalculating_ = false;
 }
 
+void PlanetTimeline::SetShipsToTakeOver(const int when) {
+    const int prev_owner = owner_[when - 1];
+    const int base_ships = ships_[when - 1] + (kNeutral == prev_owner ? 0 : planet_->GrowthRate());
+
+    const int neutral_ships = (kNeutral == prev_owner ? base_ships : 0);
+    const int my_ships = my_arrivals_[when] + (kMe == prev_owner ? base_ships : 0);
+    const int enemy_ships = enemy_arrivals_[when] + (kEnemy == prev_owner ? base_ships : 0);
+
+    const int my_total_opponents = std::max(neutral_ships, enemy_ships) - my_ships + (kMe == prev_owner ? 0 : 1);
+    const int enemy_total_opponents = std::max(neutral_ships, my_ships) - enemy_ships + (kEnemy == prev_owner ? 0 : 1);
+    ships_to_take_over_[when] = my_total_opponents * (kMe == owner_[when] ? 0 : 1);
+    enemy_ships_to_take_over_[when] = enemy_total_opponents * (kEnemy == owner_[when] ? 0 : 1);
+}
+
+int PlanetTimeline::NextEventTurn(const int from) const {
+    for (int i = from; i < horizon_; ++i) {
+        const int activity = my_arrivals_[i] | enemy_arrivals_[i] | my_departures_[i] | enemy_departures_[i]
+            | my_contingent_departures_[i] | enemy_contingent_departures_[i];
+
+        if (0 != activity) {
+            return i;
+        }
+    }
+
+    return horizon_;
+}
+
+void PlanetTimeline::FillQuietTurns(const int from, const int to) {
+    const int growth_rate = planet_->GrowthRate();
+    const int owner = owner_[from - 1];
+    const int start_ships = ships_[from - 1];
+    const int turn_growth = (kNeutral == owner ? 0 : growth_rate);
+
+    const int my_multiplier = (kMe == owner ? 1 : 0);
+    const int enemy_multiplier = (kEnemy == owner ? 1 : 0);
+    const int ships_gained = PlanetShipsGainRate(owner, growth_rate);
+    const int my_growth = growth_rate * my_multiplier;
+    const int enemy_growth = growth_rate * enemy_multiplier;
+
+    will_be_mine_ |= (kMe == owner);
+    will_not_be_mine_ |= (kMe != owner);
+    will_be_enemys_ |= (kEnemy == owner);
+    will_not_be_enemys_ |= (kEnemy != owner);
+
+    for (int i = from; i < to; ++i) {
+        const int ships = start_ships + (i - from + 1) * turn_growth;
+        owner_[i] = owner;
+        ships_[i] = ships;
+
+        //Whoever doesn't own the planet has to beat its garrison by one ship.
+        ships_to_take_over_[i] = (ships + 1) * (1 - my_multiplier);
+        enemy_ships_to_take_over_[i] = (ships + 1) * (1 - enemy_multiplier);
+
+        ships_gained_[i] = ships_gained;
+        available_growth_[i] = my_growth;
+        enemy_available_growth_[i] = enemy_growth;
+    }
+}
+
+void PlanetTimeline::PrepareToRecalculateFrom(const int starting_at) {
+    game_timeline_->JournalTimeline(id_);
+
+    pw_assert(1 < starting_at && starting_at <= horizon_);
+    const int growth_rate = planet_->GrowthRate();
+
+    //The earlier turns are as they were, apart from the ships to take over, which
+    //were filled in from the turns that are about to change.
+    for (int i = 1; i < starting_at; ++i) {
+        this->SetShipsToTakeOver(i);
+    }
+
+    ships_to_take_over_[0] = 0;
+
+    //Start the reservations from scratch, as ResetStartingData() does.
+    for (int i = 0; i < horizon_; ++i) {
+        ships_reserved_[i] = 0;
+        enemy_ships_reserved_[i] = 0;
+    }
+
+    const int current_owner = owner_[0];
+    available_growth_[0] = 0;
+    enemy_available_growth_[0] = 0;
+
+    will_not_be_mine_ = (kMe != current_owner);
+    will_be_mine_ = (kMe == current_owner);
+    will_not_be_enemys_ = (kEnemy != current_owner);
+    will_be_enemys_ = (kEnemy == current_owner);
+
+    for (int i = 1; i < starting_at; ++i) {
+        const int owner = owner_[i];
+        available_growth_[i] = (kMe == owner ? growth_rate : 0);
+        enemy_available_growth_[i] = (kEnemy == owner ? growth_rate : 0);
+
+        will_be_mine_ |= (kMe == owner);
+        will_not_be_mine_ |= (kMe != owner);
+        will_be_enemys_ |= (kEnemy == owner);
+        will_not_be_enemys_ |= (kEnemy != owner);
+    }
+
+    //Redo the reservations of the earlier turns in the same order as the forward
+    //pass.  Reservations by the same player at the same turn add up, so one
+    //reservation per player and turn does.
+    for (int i = 0; i < starting_at; ++i) {
+        const int my_reservation = my_reservations_[i];
+        const int enemy_reservation = enemy_reservations_[i];
+        my_reservations_[i] = 0;
+        enemy_reservations_[i] = 0;
+
+        if (0 != my_reservation) {
+            this->ReserveShips(kMe, i, my_reservation);
+        }
+
+        if (0 != enemy_reservation) {
+            this->ReserveShips(kEnemy, i, enemy_reservation);
+        }
+    }
+
+    for (int i = starting_at; i < horizon_; ++i) {
+        my_reservations_[i] = 0;
+        enemy_reservations_[i] = 0;
+    }
+}
+
 void PlanetTimeline::ReserveShips(const int owner, const int key_time, const int num_ships) {
     pw_assert(key_time < horizon_);
     
@@ -1440,9 +2156,10 @@ void PlanetTimeline::ReserveShips(const int owner, const int key_time, const int
     }
 #endif
 
-    std::vector<int>& ships_reserved = (owner == kMe ? ships_reserved_ : enemy_ships_reserved_);
-    std::vector<int>& ships_free = (owner == kMe ? ships_free_ : enemy_ships_free_);
-    std::vector<int>& available_growth = (owner == kMe ? available_growth_ : enemy_available_growth_);
+    int* ships_reserved = (owner == kMe ? ships_reserved_ : enemy_ships_reserved_);
+    int* available_growth = (owner == kMe ? available_growth_ : enemy_available_growth_);
+    int* reservations = (owner == kMe ? my_reservations_ : enemy_reservations_);
+    reservations[key_time] += num_ships;
     
     const int growth_rate = planet_->GrowthRate();
     int ships_to_reserve = num_ships;
@@ -1454,21 +2171,31 @@ void PlanetTimeline::ReserveShips(const int owner, const int key_time, const int
         available_growth[i] -= growth_towards_reservations;
         ships_to_reserve -= growth_towards_reservations;
 
-        //Reserve the ships, if necessary.
+        //Reserve the ships, if necessary.  The free ships are worked out from
+        //the reservations once the timeline is recalculated.
         if (0 >= ships_to_reserve) {
             break;
 
         } else {
             ships_reserved[i] += ships_to_reserve;
-            const int ships_unavailable = ships_reserved[i];
-            const int owned_ships_on_planet = (owner == owner_[i] ? ships_[i] : 0);
-            ships_free[i] = std::max(owned_ships_on_planet - ships_unavailable, 0);
-
         }
     }
 }
 
+void PlanetTimeline::UpdateShipsFree(const int until) {
+    for (int i = 0; i < until; ++i) {
+        const int owner = owner_[i];
+        const int my_ships = (kMe == owner ? ships_[i] : 0);
+        const int enemy_ships = (kEnemy == owner ? ships_[i] : 0);
+
+        ships_free_[i] = std::max(my_ships - ships_reserved_[i], 0);
+        enemy_ships_free_[i] = std::max(enemy_ships - enemy_ships_reserved_[i], 0);
+    }
+}
+
 void PlanetTimeline::RecalculateShipsGained() {
+    game_timeline_->JournalBalances(id_);
+
     //Recalculate ships gained after a balance calculation.
     bool would_planet_be_lost = false;
     const int growth_rate = planet_->GrowthRate();
@@ -1500,7 +2227,39 @@ void PlanetTimeline::RecalculateShipsGained() {
     }
 }
 
+int PlanetTimeline::ShipsLostToBalances() const {
+    //The ships gained before the balances are taken into account.
+    int ships_gained = 0;
+
+    for (int t = 0; t < horizon_; ++t) {
+        ships_gained += ships_gained_[t];
+    }
+
+    ships_gained += OwnerMultiplier(owner_[horizon_ - 1]) * kAdditionalGrowthTurns * planet_->GrowthRate();
+
+    return ships_gained - total_ships_gained_;
+}
+
+int PlanetTimeline::ShipsGainedIfMineFrom(const int turn) const {
+    const int growth_rate = planet_->GrowthRate();
+    int ships_gained = 0;
+
+    for (int t = turn; t < horizon_; ++t) {
+        ships_gained += growth_rate - ships_gained_[t];
+    }
+
+    ships_gained += (1 - OwnerMultiplier(owner_[horizon_ - 1])) * kAdditionalGrowthTurns * growth_rate;
+
+    return ships_gained;
+}
+
 void PlanetTimeline::SetReinforcer(bool is_reinforcer) {
+    game_timeline_->JournalTimeline(id_);
+
+    if (is_reinforcer_ != is_reinforcer) {
+        fingerprint_ ^= this->InputKey(-1, 1);
+    }
+
     is_reinforcer_ = is_reinforcer;
     this->MarkAsChanged();
 }
@@ -1554,3 +2313,45 @@ void PlanetTimeline::RemoveDepartingActions(const int turn, const int player) {
 void PlanetTimeline::MarkAsChanged() {
     game_timeline_->MarkTimelineAsModified(id_);
 }
+
+void PlanetTimeline::AddToInput(int* input, const int when, const int num_ships) {
+    const int position = static_cast<int>(input - arrays_) + when;
+    fingerprint_ ^= this->InputKey(position, input[when]);
+    input[when] += num_ships;
+    fingerprint_ ^= this->InputKey(position, input[when]);
+}
+
+uint64 PlanetTimeline::InputKey(const int position, const int value) const {
+    if (0 == value) {
+        return 0;
+    }
+
+    //Mix the planet, the position and the value into 64 random-looking bits
+    //(the finalizer of splitmix64).
+    uint64 key = (static_cast<uint64>(id_) << 48) ^ (static_cast<uint64>(position & 0xFFFF) << 32)
+        ^ static_cast<uint64>(static_cast<uint>(value));
+    key += 0x9E3779B97F4A7C15ULL;
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+    return key ^ (key >> 31);
+}
+
+uint64 PlanetTimeline::ComputeFingerprint() const {
+    //The planet's state and the reinforcer flag use positions outside arrays_.
+    uint64 fingerprint = this->InputKey(-1, is_reinforcer_ ? 1 : 0)
+        ^ this->InputKey(-2, planet_->Owner() + 1) ^ this->InputKey(-3, planet_->NumShips() + 1);
+
+    int* const inputs[] = {my_arrivals_, enemy_arrivals_, my_departures_, enemy_departures_,
+        my_unreserved_arrivals_, my_contingent_departures_, enemy_contingent_departures_};
+    const int num_inputs = sizeof(inputs) / sizeof(inputs[0]);
+
+    for (int i = 0; i < num_inputs; ++i) {
+        const int position = static_cast<int>(inputs[i] - arrays_);
+
+        for (int t = 0; t < horizon_; ++t) {
+            fingerprint ^= this->InputKey(position + t, inputs[i][t]);
+        }
+    }
+
+    return fingerprint;
+}
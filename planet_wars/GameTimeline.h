@@ -23,8 +23,19 @@ public:
 
     void SetGameMap(GameMap* game);
 
+    //Make this timeline a private copy of another one, so that it can be
+    //used on another thread.  The departing actions in the copy are copies
+    //of the original actions, taken from this thread's action pool.  The
+    //copy keeps its own feeder attack permissions, which must already be
+    //the same as the original's.
+    void Fork(GameTimeline* original);
+
 	int Horizon() const						{return horizon_;}
 
+    //A fingerprint of the working timelines.  Game timelines with the same
+    //fingerprint forecast the same.
+    uint64 Fingerprint() const;
+
     //Recalculate the forecasts given the state of the game map.
     void Update();
 
@@ -35,6 +46,9 @@ public:
     int ShipsGainedFromBase() const;
     int ShipsGainedFromBase(PlanetTimeline* planet) const;
 
+    //Ships that all the planets are expected to lose to the strategic balances.
+    int ShipsLostToBalances() const;
+
     //Get the timeline that had the worst ship return in return from the base.
     //Return NULL if none.
     PlanetTimeline* HighestShipLossTimeline();
@@ -73,6 +87,22 @@ public:
 
     void MarkTimelineAsModified(int timeline_id);
 
+    //Speculative changes.  PushSavepoint() marks the current state of the
+    //working timelines, and PopSavepoint() rolls back every change made since
+    //the most recent savepoint and removes it.  Savepoints can be nested, and
+    //PopSavepoints() rolls back to any earlier level.  Only the timelines that
+    //were actually changed since a savepoint are restored.
+    int PushSavepoint();
+    void PopSavepoint();
+    void PopSavepoints(int level);
+    int NumSavepoints() const                       {return static_cast<int>(savepoints_.size());}
+
+    //Record a timeline's state before it changes, if it has not been recorded
+    //since the latest savepoint.  JournalBalances() records only the strategic
+    //balances.
+    void JournalTimeline(int timeline_id);
+    void JournalBalances(int timeline_id);
+
     //Get the difference between negative strategic balances in the 
     //base timelines and working timelines.  Positive numbers are better.
     int NegativeBalanceImprovement();
@@ -88,12 +118,53 @@ public:
 #endif
 
 private:
+    //The bound on the horizon that the balance updates are compiled for, or 0
+    //if the horizon is over all of the bounds.
+    static int MaxHorizonFor(int horizon);
+
+    template <int kMaxHorizon> void UpdateAllBalances();
+    template <int kMaxHorizon> void UpdateChangedBalances(const PlanetTimelineList& modified_planets);
+
     int horizon_;
+    int max_horizon_;
     GameMap* game_;
     PlanetTimelineList planet_timelines_;
     PlanetTimelineList base_planet_timelines_;
     std::vector<bool> are_working_timelines_different_;
     std::vector<int>* when_is_feeder_allowed_to_attack_;
+    ActionList forked_actions_;
+
+#ifndef IS_SUBMISSION
+    //Checks since the working timelines were last compared in full.
+    int num_checks_since_full_check_;
+#endif
+
+    //Temporary storage.
+    std::vector<int> balance_changes_;
+    std::vector<ActionList> arrivals_by_target_;
+    PlanetTimelineList changed_timelines_;
+    std::vector<bool> needs_recalculation_;
+    PlanetTimelineList modified_sources_;
+    PlanetTimelineList nearby_sources_;
+    std::vector<int> distances_to_sources_;
+
+    //The undo journal.  Each entry holds a copy of a timeline as it was before
+    //being changed.  Entry i is stored in journal_copies_[i]; the copies are
+    //reused between savepoints.
+    class JournalEntry {
+    public:
+        int timeline_id;
+        bool is_balances_only;
+        bool was_different_from_base;
+        int prev_journal_level;
+        int prev_balances_journal_level;
+    };
+
+    std::vector<JournalEntry> journal_;
+    PlanetTimelineList journal_copies_;
+    std::vector<uint> savepoints_;                  //Journal sizes at each savepoint.
+    std::vector<int> timeline_journal_levels_;      //Savepoint level at which each timeline was last recorded.
+    std::vector<int> balances_journal_levels_;
 };
 
 //A class for forecasting the state of each planet.
@@ -106,10 +177,16 @@ public:
     void Initialize(int forecast_horizon, Planet* planet, GameMap* game, GameTimeline* game_timeline);
     
     void Copy(PlanetTimeline* other);
+    void SetGameTimeline(GameTimeline* game_timeline)   {game_timeline_ = game_timeline;}
     void CopyTimeline(PlanetTimeline* other);
     void CopyBalances(PlanetTimeline* other);
     bool Equals(PlanetTimeline* other) const;
 
+    //A fingerprint of everything the forecast is worked out from: the planet's
+    //current state, the arrivals and departures, and whether the planet is a
+    //reinforcer.  Timelines with the same fingerprint forecast the same.
+    uint64 Fingerprint() const              {return fingerprint_;}
+
     void Update();
 
     //Calculate how many additional ships would be gained if specified
@@ -118,6 +195,14 @@ public:
 
     int ShipsGained() const                 {return total_ships_gained_;}
 
+    //Ships that the planet is expected to lose to the strategic balances, by
+    //growing ships for the player that would then lose it.  Never negative.
+    int ShipsLostToBalances() const;
+
+    //The most that ships gained could grow if I owned the planet from the given 
+    //turn on.  Never negative.
+    int ShipsGainedIfMineFrom(int turn) const;
+
     Planet* GetPlanet() const               {return planet_;}
     int Id() const                          {return id_;}
 
@@ -140,9 +225,21 @@ public:
 	bool WillBeOwnedBy(int owner) const;
     bool WillNotBeOwnedBy(int player) const;
 
+    ActionList& DepartingActions()          {return departing_actions_;}
+
     //Apply actions to the timeline.
     void AddDeparture(Action* action);
     void AddArrivals(const ActionList& actions);
+
+    //Same as the Add*() above, but leave the recalculation to the caller, so
+    //that many changes can share a single RecalculateAfterChanges().  Return
+    //whether the timeline needs to be recalculated.
+    bool RecordDeparture(Action* action);
+    bool RecordArrivals(const ActionList& actions);
+
+    //Bring the timeline up to date with the changes recorded since the last
+    //recalculation.  Only the turns from the earliest change on are replayed.
+    void RecalculateAfterChanges();
 	
 	//Remove actions from the timeline.  Unlike the Add*() above, these do 
 	//not cause recalculations in planets' timelines.  RecalculateTimeline()
@@ -154,7 +251,7 @@ public:
     int EnemyArrivalsAt(int when) const     {return enemy_arrivals_[when];}
     
     //Dealing with strategic balances.
-    std::vector<int>& Balances()                {return balances_;}
+    int* Balances()                             {return balances_;}
     int BalanceAt(int t, int d) const           {return balances_[t*(t-1)/2 + d - 1];}
     void SetBalanceAt(int t, int d, int balance){balances_[t*(t-1)/2 + d - 1] = balance;}
     int MaxBalanceAt(int t) const               {return max_balances_[t];}
@@ -168,6 +265,10 @@ public:
     void SetFirstPositiveMaxBalanceTurn(int t)  {first_positive_max_balance_turn_ = t;}
     void SetTotalNegativeMinBalance(int balance){total_negative_min_balance_ = balance;}
     bool HasBalanceChangedFate() const          {return has_balance_changed_fate_;}
+
+    //Whether the balances have been calculated since the timeline last changed.
+    bool AreBalancesUpToDate() const            {return are_balances_up_to_date_;}
+    void SetBalancesUpToDate(bool is_up_to_date){are_balances_up_to_date_ = is_up_to_date;}
     
      //Reset various data before starting full timeline recalculation.
     void ResetStartingData();
@@ -187,6 +288,28 @@ public:
 private:
     //Reserve ships for a departure or defense.
     void ReserveShips(int owner, int key_time, int num_ships);
+
+    //Work out the ships free at the turns before until from the ships on the
+    //planet and the ships reserved.
+    void UpdateShipsFree(int until);
+
+    //Set the ships needed to take over the planet at a turn, before they are
+    //filled in from the later turns.
+    void SetShipsToTakeOver(int when);
+
+    //Restore the reservations, growth and ownership summaries of the turns
+    //before starting_at to what a full recalculation would leave them at, so
+    //that RecalculateTimeline() can carry on from starting_at.
+    void PrepareToRecalculateFrom(int starting_at);
+
+    //The first turn at or after the given one where fleets arrive or depart.
+    //Returns horizon_ if there are none.
+    int NextEventTurn(int from) const;
+
+    //Fill in the turns [from, to) during which no fleets arrive or depart.
+    //The owner stays the same and the ships grow at a constant rate, so each
+    //turn follows from the turn before from in closed form.
+    void FillQuietTurns(int from, int to);
     //void UnreserveShips(int owner, int key_time, int num_ships);
 
     //Remove a departing action.
@@ -194,42 +317,76 @@ private:
     void RemoveDepartingActions(int turn, int player);
     void MarkAsChanged();
 
+    //Add ships to one of the arrival or departure arrays at a turn, and update
+    //the fingerprint to match.
+    void AddToInput(int* input, int when, int num_ships);
+
+    //The fingerprint's share for a value at a position within arrays_.
+    uint64 InputKey(int position, int value) const;
+    uint64 ComputeFingerprint() const;
+
+    //Whether last turn's forecast still holds one turn later: no fleets are
+    //on their way, nothing departs, and the planet is as forecast.  Update()
+    //then shifts the forecast by a turn instead of rebuilding it.
+    bool IsForecastStillValid() const;
+    void ShiftForecast();
+
+    //Lay out all the forecast arrays within a single zeroed block.
+    void AllocateArrays(int horizon);
+
     int id_;        //Should be same as planet_id.
     int horizon_;
-    std::vector<int> owner_;
-    std::vector<int> ships_;
-    std::vector<int> my_arrivals_;
-    std::vector<int> enemy_arrivals_;
-    std::vector<int> ships_to_take_over_;
-    std::vector<int> ships_gained_;
-    std::vector<int> available_growth_;
-    std::vector<int> ships_reserved_;
-    std::vector<int> ships_free_;
-
-    std::vector<int> enemy_ships_to_take_over_;
-    std::vector<int> enemy_ships_reserved_;
-    std::vector<int> enemy_ships_free_;
-    std::vector<int> enemy_available_growth_;
+
+    //The forecast arrays below all point into one block of memory, each
+    //array starting on its own cache line.  This keeps the timeline
+    //recalculations within a contiguous stretch of memory and makes copying
+    //a timeline a single memcpy().
+    std::vector<int> array_storage_;
+    int* arrays_;           //Cache-aligned start of the block within array_storage_.
+    int arrays_size_;
+
+    int* owner_;
+    int* ships_;
+    int* my_arrivals_;
+    int* enemy_arrivals_;
+    int* ships_to_take_over_;
+    int* ships_gained_;
+    int* available_growth_;
+    int* ships_reserved_;
+    int* ships_free_;
+
+    int* enemy_ships_to_take_over_;
+    int* enemy_ships_reserved_;
+    int* enemy_ships_free_;
+    int* enemy_available_growth_;
     
-    std::vector<int> my_departures_;
-    std::vector<int> enemy_departures_;
+    int* my_departures_;
+    int* enemy_departures_;
+
+    int* my_unreserved_arrivals_;   //Arrivals on enemy planets that should not reserve enemy ships.
+    int* my_contingent_departures_;     //Departures that reserve ships but don't subtract shps.
+    int* enemy_contingent_departures_;
+
+    //The ships reserved for the battles and departures at each turn.
+    int* my_reservations_;
+    int* enemy_reservations_;
 
-    std::vector<int> my_unreserved_arrivals_;   //Arrivals on enemy planets that should not reserve enemy ships.
-    std::vector<int> my_contingent_departures_;     //Departures that reserve ships but don't subtract shps.
-    std::vector<int> enemy_contingent_departures_;
+    //The earliest turn changed since the timeline was last recalculated.
+    int earliest_change_;
 
     int total_ships_gained_;
 
     ActionList departing_actions_;
 
     //Strategic balances.
-    std::vector<int> balances_;
-    std::vector<int> min_balances_;
-    std::vector<int> max_balances_;
+    int* balances_;
+    int* min_balances_;
+    int* max_balances_;
     int first_negative_min_balance_turn_;
     int first_positive_max_balance_turn_;
     int total_negative_min_balance_;
     bool has_balance_changed_fate_;
+    bool are_balances_up_to_date_;
 
     //Indicates whether the planet will not be mine at any point
     //in the evaluated time frame.
@@ -246,6 +403,7 @@ private:
     mutable std::vector<int> additional_arrivals_;
 
     bool is_reinforcer_;
+    uint64 fingerprint_;
     bool is_recalculating_;
 };
 
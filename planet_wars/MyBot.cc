@@ -1,14 +1,41 @@
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <list>
 #include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+    #include <io.h>
+    #define read _read
+#else
+    #include <unistd.h>
+#endif
+
 #include "Actions.h"
 #include "Bot.h"
 #include "PlanetWars.h"
 #include "Timer.h"
 #include "Utils.h"
 
+#ifdef WITH_WATCHDOG
+#include "Watchdog.h"
+#endif
+
+#ifdef WITH_PONDERING
+#include "Ponderer.h"
+#endif
+
 Bot* g_bot = NULL;
 
+#ifdef WITH_WATCHDOG
+Watchdog* g_watchdog = NULL;
+#endif
+
+#ifdef WITH_PONDERING
+Ponderer* g_ponderer = NULL;
+#endif
+
 // The DoTurn function is where your code goes. The PlanetWars object contains
 // the state of the game, including information about all planets and fleets
 // that currently exist. Inside this function, you issue orders using the
@@ -23,9 +50,22 @@ void DoTurn(GameMap* game_map) {
     if (game_map->Turn() == 1) {
         g_bot = new Bot();
         g_bot->SetGame(game_map);
+
+#ifdef WITH_WATCHDOG
+        g_bot->SetWatchdog(g_watchdog);
+#endif
     }
 
-    ActionList final_actions = g_bot->MakeMoves();
+    ActionList final_actions;
+
+#ifdef WITH_PONDERING
+    //Use the moves found during the enemy's turn if the enemy did as expected.
+    if (!g_ponderer->Finish(*game_map, *g_bot, final_actions)) {
+        final_actions = g_bot->MakeMoves();
+    }
+#else
+    final_actions = g_bot->MakeMoves();
+#endif
     
 #ifndef IS_SUBMISSION
     //Output the game state to stderr.
@@ -40,12 +80,27 @@ void DoTurn(GameMap* game_map) {
     }
 #endif
 
+    //Whether final_actions are the orders that the game engine got.
+    bool were_orders_sent = true;
+
+#ifdef WITH_WATCHDOG
+    were_orders_sent = g_watchdog->FinishTurn(final_actions);
+#else
     for (unsigned int i = 0; i < final_actions.size(); ++i) {
         std::cout << final_actions[i]->ToMoveOrder();
     }
 
     std::cout << "go" << std::endl;
     std::cout.flush();
+#endif
+
+#ifdef WITH_PONDERING
+    //Think about the next turn while the enemy thinks about this one.  If the
+    //watchdog sent other orders, the state to ponder is not known.
+    if (were_orders_sent) {
+        g_ponderer->Start(*game_map, final_actions, *g_bot);
+    }
+#endif
 
     //Clean up the fleets.
     for (uint i = 0; i < final_actions.size(); ++i) {
@@ -56,56 +111,118 @@ void DoTurn(GameMap* game_map) {
 
 // This is just the main game loop that takes care of communicating with the
 // game engine for you. You don't have to understand or change the code below.
+//
+// Input is read in large blocks, and every line is parsed in place straight
+// into the game map as soon as it arrives, without building strings.
+static const int kReadBufferSize = 1 << 16;
+
+static char g_read_buffer[kReadBufferSize];
+
+//A line split across reads is gathered here, however long it is.
+static std::vector<char> g_line_buffer;
+
+//Handle one complete line of input.
+void HandleLine(GameMap& game_map, const char* line, const char* line_end, int& turn) {
+    if (line_end - line >= 2 && 'g' == line[0] && 'o' == line[1]) {
+        turn++;
+        const double timeout = (turn == 1 ? 2.95 : 0.95);
+        SetTimeOut(timeout);
+
+#ifdef WITH_WATCHDOG
+        //Step in shortly after the search is supposed to have given up.
+        g_watchdog->StartTurn(timeout + 0.03);
+#endif
+
+        game_map.EndState();
+        
+        //Make the moves.
+        DoTurn(&game_map);
+
+#ifndef IS_SUBMISSION
+        std::stringstream time_report;
+        time_report << "\nTurn time: " << MillisElapsed() << "ms";
+
+#ifdef WITH_PONDERING
+        time_report << ", pondered turns: " << g_ponderer->NumHits() 
+            << "/" << (g_ponderer->NumHits() + g_ponderer->NumMisses());
+#endif
+        std::cerr << time_report.str();
+        std::cerr.flush();
+#endif            
+        game_map.BeginState();
+
+    } else {
+        game_map.ParseStateLine(line, line_end);
+    }
+}
+
 int main(int argc, char *argv[]) {
     GameMap game_map;
-    
-    std::string current_line;
-    std::string map_data;
-    
     int turn = 0;
 
     //Crash!
     //forceCrash();
 
+#ifdef WITH_WATCHDOG
+    g_watchdog = new Watchdog();
+
+    //Only the main search, and the search tasks it hands out, stop when the
+    //watchdog steps in.
+    SetStopFlag(g_watchdog->TimeOutFlag());
+#endif
+
+#ifdef WITH_PONDERING
+    g_ponderer = new Ponderer();
+
+#ifdef WITH_WATCHDOG
+    g_ponderer->SetWatchdog(g_watchdog);
+#endif
+#endif
+
+    game_map.BeginState();
+
     while (true) {
         //Read the updated game state.
-        int c = std::cin.get();
-        current_line += (char)c;
-        
-        if (c == '\n') {
-            if (current_line.length() >= 2 && current_line.substr(0, 2) == "go") {
-                turn++;
-                const double timeout = (turn == 1 ? 2.95 : 0.95);
-                SetTimeOut(timeout);
-                
-                //On the first turn, initialize the game map.
-                //On later turns, just update it.
-
-                if (1 == turn) {
-                    game_map.Initialize(map_data);
-                
-                } else {
-                    game_map.Update(map_data);
-                }
-                
-                map_data = "";
-                
-                //Make the moves.
-                DoTurn(&game_map);
+        const int bytes_read = read(0, g_read_buffer, kReadBufferSize);
+
+        if (bytes_read <= 0) {
+            break;
+        }
+
+        const char* data = g_read_buffer;
+        const char* data_end = g_read_buffer + bytes_read;
+
+        while (data != data_end) {
+            const char* line_end = static_cast<const char*>(memchr(data, '\n', data_end - data));
+
+            if (NULL == line_end) {
+                //Keep the partial line until the rest of it arrives.
+                g_line_buffer.insert(g_line_buffer.end(), data, data_end);
+                break;
+            }
+
+            if (g_line_buffer.empty()) {
+                HandleLine(game_map, data, line_end, turn);
 
-#ifndef IS_SUBMISSION
-                std::stringstream time_report;
-                time_report << "\nTurn time: " << MillisElapsed() << "ms";
-                std::cerr << time_report.str();
-                std::cerr.flush();
-#endif            
             } else {
-                map_data += current_line;
+                g_line_buffer.insert(g_line_buffer.end(), data, line_end + 1);
+
+                const char* line = &g_line_buffer[0];
+                HandleLine(game_map, line, line + g_line_buffer.size() - 1, turn);
+                g_line_buffer.clear();
             }
 
-            current_line = "";
+            data = line_end + 1;
         }
     }
 
+#ifdef WITH_PONDERING
+    delete g_ponderer;
+#endif
+
+#ifdef WITH_WATCHDOG
+    delete g_watchdog;
+#endif
+
     return 0;
 }
@@ -139,7 +139,17 @@ void Planet::RemoveShips(int amount) {
 /************************************************
                GameMap class
 ************************************************/
-GameMap::GameMap() {
+GameMap::GameMap()
+: num_planets_(0),
+num_parsed_planets_(0),
+num_parsed_fleets_(0),
+turn_(0) {
+}
+
+GameMap::~GameMap() {
+    for (uint i = 0; i < planets_.size(); ++i) {
+        delete planets_[i];
+    }
 }
 
 int GameMap::NumPlanets() const {
@@ -266,7 +276,7 @@ PlanetList GameMap::NotMyPlanetsByDistance(Planet* origin) {
     return this->NotPlayerPlanetsByDistance(kMe, origin);
 }
 
-FleetList GameMap::Fleets() const {
+const FleetList& GameMap::Fleets() const {
     return fleets_;
 }
 
@@ -414,198 +424,311 @@ struct DistanceComparer {
     }
 };
 
+//Helpers for parsing the game state in place.
+static bool IsSpace(const char c) {
+    return (' ' == c || '\t' == c || '\r' == c);
+}
+
+static const char* SkipSpaces(const char* p, const char* end) {
+    while (p != end && IsSpace(*p)) {
+        ++p;
+    }
+
+    return p;
+}
+
+//Read an integer token at p, and advance p past it.
+static bool ParseInt(const char*& p, const char* end, int& value) {
+    p = SkipSpaces(p, end);
+    const bool is_negative = (p != end && '-' == *p);
+
+    if (is_negative) {
+        ++p;
+    }
+
+    const char* digits_start = p;
+    int result = 0;
+
+    while (p != end && *p >= '0' && *p <= '9') {
+        result = result * 10 + (*p - '0');
+        ++p;
+    }
+
+    if (p == digits_start || (p != end && !IsSpace(*p))) {
+        return false;
+    }
+
+    value = (is_negative ? -result : result);
+    return true;
+}
+
+//Read a floating point token at p, and advance p past it.
+static bool ParseDouble(const char*& p, const char* end, double& value) {
+    p = SkipSpaces(p, end);
+
+    if (p == end) {
+        return false;
+    }
+
+    //The token is always followed by a space, newline, '#' or the end of the
+    //string, so strtod() cannot run past the end of the line.
+    char* number_end = NULL;
+    value = strtod(p, &number_end);
+
+    if (number_end == p || number_end > end || (number_end != end && !IsSpace(*number_end))) {
+        return false;
+    }
+
+    p = number_end;
+    return true;
+}
+
+//Skip a token at p.
+static bool SkipToken(const char*& p, const char* end) {
+    p = SkipSpaces(p, end);
+    const char* token_start = p;
+
+    while (p != end && !IsSpace(*p)) {
+        ++p;
+    }
+
+    return (p != token_start);
+}
+
 int GameMap::Initialize(const std::string& s) {
-    turn_ = 1;
+    //Start from scratch.
+    for (uint i = 0; i < planets_.size(); ++i) {
+        delete planets_[i];
+    }
 
-    //Parse the game data.
     planets_.clear();
-    fleets_.clear();
-    std::vector<std::string> lines = StringUtil::Tokenize(s, "\n");
-    int planet_id = 0;
+    planet_distances_.clear();
+    turn_ = 0;
 
-    std::vector<int> fleet_source_ids;
-    std::vector<int> fleet_destination_ids;
+    return this->Update(s);
+}
 
-    for (unsigned int i = 0; i < lines.size(); ++i) {
-        std::string& line = lines[i];
-        size_t comment_begin = line.find_first_of('#');
-        if (comment_begin != std::string::npos) {
-            line = line.substr(0, comment_begin);
-        }
+int GameMap::Update(const std::string& s) {
+    this->BeginState();
 
-        std::vector<std::string> tokens = StringUtil::Tokenize(line);
-        if (tokens.size() == 0) {
-            continue;
+    const char* line = s.c_str();
+    const char* end = line + s.size();
+
+    while (line < end) {
+        const char* line_end = line;
+
+        while (line_end != end && '\n' != *line_end) {
+            ++line_end;
         }
 
-        if (tokens[0] == "P") {
-            if (tokens.size() != 6) {
-                return 0;
-            }
-            
-            Planet* p = new Planet(planet_id++,              // The ID of this planet
-	                 atoi(tokens[3].c_str()),  // Owner
-                     atoi(tokens[4].c_str()),  // Num ships
-                     atoi(tokens[5].c_str()),  // Growth rate
-                     atof(tokens[1].c_str()),  // X
-                     atof(tokens[2].c_str())); // Y
-            planets_.push_back(p);
-        
-        } else if (tokens[0] == "F") {
-            if (tokens.size() != 7) {
-                return 0;
-            }
-            
-            Fleet* fleet = new Fleet();
-            fleet->SetOwner(atoi(tokens[1].c_str()));
-            fleet->SetNumShips(atoi(tokens[2].c_str()));
-            fleet_source_ids.push_back(atoi(tokens[3].c_str()));
-            fleet_destination_ids.push_back(atoi(tokens[4].c_str()));
-            fleet->SetTripLength(atoi(tokens[5].c_str()));
-            fleet->SetTurnsRemaining(atoi(tokens[6].c_str()));
-
-            fleets_.push_back(fleet);
-        
-        } else {
+        if (0 == this->ParseStateLine(line, line_end)) {
             return 0;
         }
-    }
 
-    //Pre-calculate the distances between the planets.
-    num_planets_ = static_cast<int>(planets_.size());
-    planet_distances_.reserve(num_planets_ * num_planets_);
+        line = line_end + 1;
+    }
 
-    for (int origin = 0; origin < num_planets_; ++origin) {
-        for (int destination = 0; destination < num_planets_; ++destination) {
-            const double dx = planets_[origin]->X() - planets_[destination]->X();
-            const double dy = planets_[origin]->Y() - planets_[destination]->Y();
+    return this->EndState();
+}
 
-            const int distance = static_cast<int>(ceil(sqrt(dx * dx + dy * dy)));
+void GameMap::BeginState() {
+    //The fleet slots are reused from turn to turn.
+    num_parsed_fleets_ = 0;
+    fleet_source_ids_.clear();
+    fleet_destination_ids_.clear();
+    num_parsed_planets_ = 0;
+}
 
-            planet_distances_.push_back(distance);
+int GameMap::ParseStateLine(const char* line, const char* line_end) {
+    //Drop the comments.
+    for (const char* c = line; c != line_end; ++c) {
+        if ('#' == *c) {
+            line_end = c;
+            break;
         }
     }
-    
-    //Resolve planet references within the fleets and assign fleets
-    //to their destinations.
-    fleets_by_destination_.resize(planets_.size());
 
-    for (unsigned int i = 0; i < fleets_.size(); ++i) {
-        Fleet* fleet = fleets_[i];
-        const int destination_id = fleet_destination_ids[i];
+    const char* p = SkipSpaces(line, line_end);
 
-        fleet->SetSource(planets_[fleet_source_ids[i]]);
-        fleet->SetDestination(planets_[destination_id]);
-        
-        fleets_by_destination_[destination_id].push_back(fleet);
+    if (p == line_end) {
+        return 1;   //Blank line.
     }
 
-    //Pre-sort planets by distance from each other.
-    //Use a functor defined immediately before this function.
-    DistanceComparer distance_comparer;
-    distance_comparer.game_map_ = this;
-    distance_comparer.origin_id = 0;
+    const char line_type = *p++;
 
-    planets_by_distance_.clear();
-    planets_by_distance_.reserve(num_planets_ * num_planets_);
-    
-    for (planet_id = 0; planet_id < num_planets_; ++planet_id) {
-        //Sort the planets by distance from the origin planet and
-        //append the result to the general vector of planets sorted
-        //by distance.
-        std::vector<Planet*> planets_to_sort(planets_);
-        distance_comparer.origin_id = planet_id;
-        std::sort(planets_to_sort.begin(), planets_to_sort.end(), distance_comparer);
-        planets_by_distance_.insert(planets_by_distance_.end(),
-            planets_to_sort.begin(), planets_to_sort.end());
+    if (p != line_end && !IsSpace(*p)) {
+        return 0;
     }
-    
-    return 1;
-}
 
-int GameMap::Update(const std::string& s) {
-    ++turn_;
+    if ('P' == line_type) {
+        //Read a line describing a planet.  The coordinates and growth rate
+        //never change, so they are only read on the first turn.
+        const bool is_new_planet = (0 == turn_);
+        double x = 0;
+        double y = 0;
+        int owner = 0;
+        int num_ships = 0;
+        int growth_rate = 0;
+
+        if (is_new_planet) {
+            if (!ParseDouble(p, line_end, x) || !ParseDouble(p, line_end, y)) {
+                return 0;
+            }
 
-    //Update the planet data; repopulate the fleets.
-    fleets_.clear();
-    std::vector<std::string> lines = StringUtil::Tokenize(s, "\n");
-    int planet_id = 0;
+        } else if (!SkipToken(p, line_end) || !SkipToken(p, line_end)) {
+            return 0;
+        }
 
-    std::vector<int> fleet_source_ids;
-    std::vector<int> fleet_destination_ids;
+        if (!ParseInt(p, line_end, owner) || !ParseInt(p, line_end, num_ships)) {
+            return 0;
+        }
 
-    for (unsigned int i = 0; i < lines.size(); ++i) {
-        std::string& line = lines[i];
-        size_t comment_begin = line.find_first_of('#');
-        if (comment_begin != std::string::npos) {
-            line = line.substr(0, comment_begin);
+        if (is_new_planet ? !ParseInt(p, line_end, growth_rate) : !SkipToken(p, line_end)) {
+            return 0;
         }
 
-        std::vector<std::string> tokens = StringUtil::Tokenize(line);
-        if (tokens.size() == 0) {
-            continue;
+        if (SkipSpaces(p, line_end) != line_end) {
+            return 0;
         }
-        
-        if (tokens[0] == "P") {
-            //Read a line describing a planet
-            if (tokens.size() != 6) {
+
+        if (is_new_planet) {
+            planets_.push_back(new Planet(num_parsed_planets_, owner, num_ships, growth_rate, x, y));
+
+        } else {
+            if (num_parsed_planets_ >= num_planets_) {
                 return 0;
             }
-            
+
             //Update the planet state.
-            Planet* planet = planets_[planet_id];
-            planet->Owner(atoi(tokens[3].c_str()));
-            planet->NumShips(atoi(tokens[4].c_str()));
+            Planet* planet = planets_[num_parsed_planets_];
+            planet->Owner(owner);
+            planet->NumShips(num_ships);
+        }
 
-            planet_id++;
-            
-        } else if (tokens[0] == "F") {
-            //Read a line describing a fleet
-            if (tokens.size() != 7) {
-                return 0;
-            }
+        ++num_parsed_planets_;
 
-            Fleet* fleet = new Fleet();
-            fleet->SetOwner(atoi(tokens[1].c_str()));
-            fleet->SetNumShips(atoi(tokens[2].c_str()));
-            fleet_source_ids.push_back(atoi(tokens[3].c_str()));
-            fleet_destination_ids.push_back(atoi(tokens[4].c_str()));
-            fleet->SetTripLength(atoi(tokens[5].c_str()));
-            fleet->SetTurnsRemaining(atoi(tokens[6].c_str()));
+    } else if ('F' == line_type) {
+        //Read a line describing a fleet.
+        int owner = 0;
+        int num_ships = 0;
+        int source_id = 0;
+        int destination_id = 0;
+        int trip_length = 0;
+        int turns_remaining = 0;
 
-            fleets_.push_back(fleet);
+        if (!ParseInt(p, line_end, owner) || !ParseInt(p, line_end, num_ships)
+            || !ParseInt(p, line_end, source_id) || !ParseInt(p, line_end, destination_id)
+            || !ParseInt(p, line_end, trip_length) || !ParseInt(p, line_end, turns_remaining)) {
+            return 0;
+        }
 
-        } else {
+        if (SkipSpaces(p, line_end) != line_end) {
             return 0;
         }
+
+        //Grow the fleet storage only when there are more fleets than ever before.
+        if (num_parsed_fleets_ == static_cast<int>(fleet_storage_.size())) {
+            fleet_storage_.push_back(Fleet());
+        }
+
+        Fleet& fleet = fleet_storage_[num_parsed_fleets_++];
+        fleet.SetOwner(owner);
+        fleet.SetNumShips(num_ships);
+        fleet.SetTripLength(trip_length);
+        fleet.SetTurnsRemaining(turns_remaining);
+
+        fleet_source_ids_.push_back(source_id);
+        fleet_destination_ids_.push_back(destination_id);
+
+    } else {
+        return 0;
     }
-    
+
+    return 1;
+}
+
+int GameMap::EndState() {
+    ++turn_;
+
+    if (1 == turn_) {
+        this->InitializeDistances();
+    }
+
     //Clear the fleets sorted by destination.
     for (uint i = 0; i < fleets_by_destination_.size(); ++i) {
         fleets_by_destination_[i].clear();
     }
 
     //Resolve planet references within the fleets, and sort the fleets
-    //by their destination.
-    for (unsigned int i = 0; i < fleets_.size(); ++i) {
-        Fleet* fleet = fleets_[i];
-        const int destination_id = fleet_destination_ids[i];
+    //by their destination.  The fleet storage does not move from here on,
+    //so it is safe to point into it.
+    fleets_.clear();
+
+    for (int i = 0; i < num_parsed_fleets_; ++i) {
+        Fleet* fleet = &fleet_storage_[i];
+        const int source_id = fleet_source_ids_[i];
+        const int destination_id = fleet_destination_ids_[i];
+
+        if (source_id < 0 || source_id >= num_planets_
+            || destination_id < 0 || destination_id >= num_planets_) {
+            return 0;
+        }
 
-        fleet->SetSource(planets_[fleet_source_ids[i]]);
+        fleet->SetSource(planets_[source_id]);
         fleet->SetDestination(planets_[destination_id]);
         
+        fleets_.push_back(fleet);
         fleets_by_destination_[destination_id].push_back(fleet);
     }
 
     return 1;
 }
 
+void GameMap::InitializeDistances() {
+    //Pre-calculate the distances between the planets.
+    num_planets_ = static_cast<int>(planets_.size());
+    planet_distances_.reserve(num_planets_ * num_planets_);
+
+    for (int origin = 0; origin < num_planets_; ++origin) {
+        for (int destination = 0; destination < num_planets_; ++destination) {
+            const double dx = planets_[origin]->X() - planets_[destination]->X();
+            const double dy = planets_[origin]->Y() - planets_[destination]->Y();
+
+            const int distance = static_cast<int>(ceil(sqrt(dx * dx + dy * dy)));
+
+            planet_distances_.push_back(distance);
+        }
+    }
+    
+    fleets_by_destination_.resize(planets_.size());
+
+    //Pre-sort planets by distance from each other.
+    //Use a functor defined immediately before this function.
+    DistanceComparer distance_comparer;
+    distance_comparer.game_map_ = this;
+    distance_comparer.origin_id = 0;
+
+    planets_by_distance_.clear();
+    planets_by_distance_.reserve(num_planets_ * num_planets_);
+    
+    for (int planet_id = 0; planet_id < num_planets_; ++planet_id) {
+        //Sort the planets by distance from the origin planet and
+        //append the result to the general vector of planets sorted
+        //by distance.
+        std::vector<Planet*> planets_to_sort(planets_);
+        distance_comparer.origin_id = planet_id;
+        std::sort(planets_to_sort.begin(), planets_to_sort.end(), distance_comparer);
+        planets_by_distance_.insert(planets_by_distance_.end(),
+            planets_to_sort.begin(), planets_to_sort.end());
+    }
+}
+
 void GameMap::FinishTurn() const {
     std::cout << "go" << std::endl;
     std::cout.flush();
 }
 
-FleetList GameMap::FleetsArrivingAt(Planet *destination) const {
+const FleetList& GameMap::FleetsArrivingAt(Planet *destination) const {
     return fleets_by_destination_[destination->Id()];
 }
 /************************************************
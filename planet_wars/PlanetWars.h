@@ -138,11 +138,21 @@ class GameMap {
 public:
     // Initializes the game state given a string containing game state data.
     GameMap();
+    ~GameMap();
     
     //Initialize/Update the game state after start of a new turn.
     int Initialize(const std::string& game_state);
     int Update(const std::string& game_state);
 
+    //Parse the game state one line at a time, in place, as the lines arrive
+    //from the game engine.  Call BeginState() before the first line of each
+    //turn, ParseStateLine() for every line up to "go", and EndState() once
+    //"go" has been received.  The first state parsed initializes the map.
+    //ParseStateLine() and EndState() return 1 on success, 0 on bad input.
+    void BeginState();
+    int ParseStateLine(const char* line, const char* line_end);
+    int EndState();
+
     // Returns the number of planets on the map. Planets are numbered starting
     // with 0.
     int NumPlanets() const;
@@ -179,7 +189,7 @@ public:
     PlanetList NotMyPlanetsByDistance(Planet* origin);
 
     // Get various lists of fleets.
-    FleetList Fleets() const;
+    const FleetList& Fleets() const;
     FleetList MyFleets() const;
     FleetList EnemyFleets() const;
 
@@ -221,16 +231,27 @@ public:
 
     //Find the list of fleets heading towards the planet.
     //Sort them by time to arrival to the destination.
-    FleetList FleetsArrivingAt(Planet* destination) const;
+    const FleetList& FleetsArrivingAt(Planet* destination) const;
 
     //Get current turn.
     int Turn() const            {return turn_;}
 
+    //Set the current turn, for a map that is not fed by the game engine.
+    void SetTurn(int turn)      {turn_ = turn;}
+
 private:
+    //Pre-calculate the distances and the planets sorted by distance.
+    void InitializeDistances();
+
     // Store all the planets and fleets. OMG we wouldn't wanna lose all the
     // planets and fleets, would we!?
     PlanetList planets_;
     FleetList fleets_;
+
+    //The fleets themselves.  Slots are reused from turn to turn, so the
+    //storage only grows when there are more fleets in flight than ever
+    //before.  fleets_ points into it.
+    std::vector<Fleet> fleet_storage_;
     
     //Distances between individual planets.
     //The distance between source and destination is stored
@@ -244,9 +265,17 @@ private:
     //element (source_id * num_planets) and ends at ((source_id+1) * num_planets - 1).
     PlanetList planets_by_distance_;
 
-    //Fleets sorted by their destination.
+    //Fleets sorted by their destination.  Like the fleet storage, these
+    //keep their capacity between turns.
     std::vector<FleetList> fleets_by_destination_;
 
+    //Fleet endpoints read by ParseStateLine(); resolved into planets
+    //by EndState().
+    std::vector<int> fleet_source_ids_;
+    std::vector<int> fleet_destination_ids_;
+    int num_parsed_planets_;
+    int num_parsed_fleets_;
+
     //Current turn.
     int turn_;
 };
@@ -0,0 +1,299 @@
+//Available under GPLv3.
+//Author: Iouri Khramtsov.
+
+//Searches for the next turn's moves while the enemy is thinking.
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include "GameTimeline.h"
+#include "Ponderer.h"
+#include "Timer.h"
+
+#ifdef WITH_WATCHDOG
+#include "Watchdog.h"
+#endif
+
+#ifdef WITH_PONDERING
+
+//The pondering bot gets as much time as a regular turn.
+static const double kPonderTime = 0.95;
+
+/************************************************
+               Ponderer class
+************************************************/
+Ponderer::Ponderer()
+: is_pondering_(false),
+is_stopping_(false),
+is_cancelled_(false),
+is_waiting_(false),
+watchdog_(NULL),
+bot_(NULL),
+num_hits_(0),
+num_misses_(0) {
+    thread_ = std::thread(&Ponderer::PonderLoop, this);
+}
+
+Ponderer::~Ponderer() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        is_stopping_ = true;
+        is_cancelled_ = true;
+    }
+
+    state_changed_.notify_all();
+    thread_.join();
+
+    delete bot_;
+}
+
+void Ponderer::Start(const GameMap& game_map, const ActionList& orders, const Bot& bot) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    //Let the last search wind down.
+    while (is_pondering_) {
+        state_changed_.wait(lock);
+    }
+
+    predicted_state_ = PredictedState(game_map, orders);
+
+    if (NULL == bot_) {
+        game_map_.Initialize(predicted_state_);
+        //Pondering overlaps with the main search, which already has a thread
+        //per core.  Keep the pondering to this thread.
+        bot_ = new Bot();
+        bot_->DisableSearchThreads();
+        bot_->SetGame(&game_map_);
+        bot_->ponderer_ = this;
+
+    } else {
+        game_map_.Update(predicted_state_);
+    }
+
+    //The predicted state is for the next turn, however many turns went unpondered.
+    game_map_.SetTurn(game_map.Turn() + 1);
+
+    //The only state that the bot carries between turns.
+    bot_->turn_ = bot.turn_;
+    bot_->when_is_feeder_allowed_to_attack_ = bot.when_is_feeder_allowed_to_attack_;
+
+    published_actions_.clear();
+    is_cancelled_ = false;
+    is_pondering_ = true;
+    lock.unlock();
+
+    state_changed_.notify_all();
+}
+
+bool Ponderer::Finish(const GameMap& game_map, Bot& bot, ActionList& actions) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (predicted_state_.empty()) {
+        return false;
+    }
+
+    const std::string state = WriteState(game_map, std::vector<int>(), std::vector<int>(), CopyFleets(game_map));
+    const bool is_as_predicted = (state == predicted_state_);
+    predicted_state_.clear();
+
+    if (!is_as_predicted) {
+        //The search is of no use.  Don't wait for it to stop.
+        is_cancelled_ = true;
+        ++num_misses_;
+        return false;
+    }
+
+#ifdef WITH_WATCHDOG
+    //If the turn runs out of time before the search finishes, send the moves
+    //found so far.
+    if (NULL != watchdog_) {
+        ActionList published_actions = bot.RestoreActions(published_actions_);
+        watchdog_->Publish(published_actions);
+        Action::FreeActions(published_actions);
+    }
+#endif
+
+    //The bot skips its own MakeMoves() this turn, but its timeline must still
+    //move on a turn, as the pondering bot's did.
+    is_waiting_ = true;
+    lock.unlock();
+    bot.timeline_->Update();
+    lock.lock();
+
+    while (is_pondering_) {
+        state_changed_.wait(lock);
+    }
+
+    is_waiting_ = false;
+    ++num_hits_;
+    bot.turn_ = bot_->turn_;
+    bot.when_is_feeder_allowed_to_attack_ = bot_->when_is_feeder_allowed_to_attack_;
+    actions = bot.RestoreActions(pondered_actions_);
+
+    return true;
+}
+
+void Ponderer::Publish(const ActionList& actions) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    Bot::RecordActions(actions, published_actions_);
+
+#ifdef WITH_WATCHDOG
+    if (is_waiting_ && NULL != watchdog_) {
+        watchdog_->Publish(actions);
+    }
+#endif
+}
+
+void Ponderer::PonderLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (!is_stopping_) {
+        if (!is_pondering_) {
+            state_changed_.wait(lock);
+            continue;
+        }
+
+        lock.unlock();
+        this->Ponder();
+        lock.lock();
+
+        is_pondering_ = false;
+        state_changed_.notify_all();
+    }
+}
+
+void Ponderer::Ponder() {
+    SetTimeOut(kPonderTime);
+    SetStopFlag(&is_cancelled_);
+
+    ActionList actions = bot_->MakeMoves();
+
+    //Hand the moves over as plain data; the actions go back to this thread's pool.
+    Bot::RecordActions(actions, pondered_actions_);
+    Action::FreeActions(actions);
+}
+
+std::string Ponderer::PredictedState(const GameMap& game_map, const ActionList& orders) {
+    const int num_planets = game_map.NumPlanets();
+    std::vector<int> owners(num_planets);
+    std::vector<int> num_ships(num_planets);
+    std::vector<Fleet> fleets = CopyFleets(game_map);
+
+    for (int i = 0; i < num_planets; ++i) {
+        Planet* planet = game_map.GetPlanet(i);
+        owners[i] = planet->Owner();
+        num_ships[i] = planet->NumShips();
+    }
+
+    //Send the fleets.
+    for (uint i = 0; i < orders.size(); ++i) {
+        const Action* order = orders[i];
+
+        if (0 != order->DepartureTime()) {
+            continue;
+        }
+
+        const int source_id = order->Source()->Id();
+        const int target_id = order->Target()->Id();
+        const int distance = game_map.GetDistance(source_id, target_id);
+
+        num_ships[source_id] -= order->NumShips();
+        fleets.push_back(Fleet(kMe, order->NumShips(),
+            game_map.GetPlanet(source_id), game_map.GetPlanet(target_id), distance, distance));
+    }
+
+    //Grow the ships on the owned planets.
+    for (int i = 0; i < num_planets; ++i) {
+        if (kNeutral != owners[i]) {
+            num_ships[i] += game_map.GetPlanet(i)->GrowthRate();
+        }
+    }
+
+    //Advance the fleets.
+    for (uint i = 0; i < fleets.size(); ++i) {
+        fleets[i].SetTurnsRemaining(std::max(fleets[i].TurnsRemaining() - 1, 0));
+    }
+
+    //Fight the battles, planet by planet, as the game engine does.
+    for (int i = 0; i < num_planets; ++i) {
+        int my_arrivals = 0;
+        int enemy_arrivals = 0;
+        bool has_arrivals = false;
+        uint num_remaining_fleets = 0;
+
+        for (uint j = 0; j < fleets.size(); ++j) {
+            const Fleet& fleet = fleets[j];
+
+            if (fleet.Destination()->Id() == i && 0 == fleet.TurnsRemaining()) {
+                has_arrivals = true;
+
+                if (kMe == fleet.Owner()) {
+                    my_arrivals += fleet.NumShips();
+                } else {
+                    enemy_arrivals += fleet.NumShips();
+                }
+
+            } else {
+                fleets[num_remaining_fleets++] = fleet;
+            }
+        }
+
+        fleets.resize(num_remaining_fleets);
+
+        if (!has_arrivals) {
+            continue;
+        }
+
+        const int owner = owners[i];
+        const int ships = num_ships[i];
+        const int neutral_ships = (kNeutral == owner ? ships : 0);
+        const int my_ships = my_arrivals + (kMe == owner ? ships : 0);
+        const int enemy_ships = enemy_arrivals + (kEnemy == owner ? ships : 0);
+
+        const BattleOutcome outcome = ResolveBattle(owner, neutral_ships, my_ships, enemy_ships);
+        owners[i] = outcome.owner;
+        num_ships[i] = outcome.ships_remaining;
+    }
+
+    return WriteState(game_map, owners, num_ships, fleets);
+}
+
+std::vector<Fleet> Ponderer::CopyFleets(const GameMap& game_map) {
+    const FleetList& fleets = game_map.Fleets();
+    std::vector<Fleet> fleet_copies;
+    fleet_copies.reserve(fleets.size());
+
+    for (uint i = 0; i < fleets.size(); ++i) {
+        fleet_copies.push_back(*fleets[i]);
+    }
+
+    return fleet_copies;
+}
+
+std::string Ponderer::WriteState(const GameMap& game_map,
+                                 const std::vector<int>& owners,
+                                 const std::vector<int>& num_ships,
+                                 const std::vector<Fleet>& fleets) {
+    //Without the owners and the ships, write the planets as they are.
+    const bool is_current_state = owners.empty();
+    std::stringstream state;
+    state << std::setprecision(17);
+
+    for (int i = 0; i < game_map.NumPlanets(); ++i) {
+        Planet* planet = game_map.GetPlanet(i);
+        state << "P " << planet->X() << " " << planet->Y()
+            << " " << (is_current_state ? planet->Owner() : owners[i])
+            << " " << (is_current_state ? planet->NumShips() : num_ships[i])
+            << " " << planet->GrowthRate() << "\n";
+    }
+
+    for (uint i = 0; i < fleets.size(); ++i) {
+        const Fleet& fleet = fleets[i];
+        state << "F " << fleet.Owner() << " " << fleet.NumShips()
+            << " " << fleet.Source()->Id() << " " << fleet.Destination()->Id()
+            << " " << fleet.TripLength() << " " << fleet.TurnsRemaining() << "\n";
+    }
+
+    return state.str();
+}
+#endif
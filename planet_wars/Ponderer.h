@@ -0,0 +1,96 @@
+//Available under GPLv3.
+//Author: Iouri Khramtsov.
+
+//Searches for the next turn's moves while the enemy is thinking.
+//Once the orders for a turn are sent, the ponderer predicts the next state
+//from the current one and our orders, assuming that the enemy sends no new
+//fleets, and has a bot of its own search that state on a separate thread.
+//When the real state arrives, the moves found are used if the real state
+//is exactly the predicted one, and thrown away otherwise.  While the turn
+//waits for the search to finish, the watchdog can send the moves found so
+//far.
+
+#ifndef PLANET_WARS_PONDERER_H_
+#define PLANET_WARS_PONDERER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "Actions.h"
+#include "Bot.h"
+#include "PlanetWars.h"
+#include "Utils.h"
+
+class Watchdog;
+
+class Ponderer {
+public:
+    Ponderer();
+    ~Ponderer();
+
+    //Publish the moves found so far to a watchdog, if one is given.
+    void SetWatchdog(Watchdog* watchdog)    {watchdog_ = watchdog;}
+
+    //Start searching the state that the orders lead to.  The bot's state is
+    //copied into the pondering bot.
+    void Start(const GameMap& game_map, const ActionList& orders, const Bot& bot);
+
+    //Check the real state against the predicted one.  If they match, bring the
+    //bot's timeline up to date, wait for the search to finish, copy the pondering
+    //bot's state into the bot, and return the moves found in actions.  Otherwise
+    //stop the search and return false.
+    bool Finish(const GameMap& game_map, Bot& bot, ActionList& actions);
+
+    //Called by the pondering bot with the moves it has settled on so far.
+    void Publish(const ActionList& actions);
+
+    int NumHits() const                     {return num_hits_;}
+    int NumMisses() const                   {return num_misses_;}
+
+private:
+    //Disallow copying.
+    Ponderer(const Ponderer&);
+    Ponderer& operator=(const Ponderer&);
+
+    void PonderLoop();
+    void Ponder();
+
+    //The state after one turn of the game with the given orders and no enemy orders.
+    static std::string PredictedState(const GameMap& game_map, const ActionList& orders);
+
+    //Copy the fleets in flight.
+    static std::vector<Fleet> CopyFleets(const GameMap& game_map);
+
+    //Write the state the way the game engine would.  The coordinates are written
+    //in full so that the distances come out the same.
+    static std::string WriteState(const GameMap& game_map,
+                                  const std::vector<int>& owners,
+                                  const std::vector<int>& num_ships,
+                                  const std::vector<Fleet>& fleets);
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable state_changed_;
+    bool is_pondering_;
+    bool is_stopping_;
+    std::atomic<bool> is_cancelled_;
+
+    //Set while a turn waits for the search.  The moves published in the
+    //meantime go straight to the watchdog.
+    bool is_waiting_;
+    Watchdog* watchdog_;
+    std::vector<ActionRecord> published_actions_;
+
+    //Only touched by the pondering thread while is_pondering_ is set.
+    GameMap game_map_;
+    Bot* bot_;
+    std::string predicted_state_;
+    std::vector<ActionRecord> pondered_actions_;
+
+    int num_hits_;
+    int num_misses_;
+};
+
+#endif
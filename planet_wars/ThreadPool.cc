@@ -0,0 +1,145 @@
+//Available under GPLv3.
+//Author: Iouri Khramtsov.
+
+//A work-stealing thread pool.  Every worker has its own queue of tasks;
+//a worker takes tasks from the back of its own queue, and when it runs
+//out of work it steals from the front of the other workers' queues.
+
+#include "ThreadPool.h"
+
+/************************************************
+               ThreadPool class
+************************************************/
+ThreadPool::ThreadPool(int num_workers)
+: num_queued_(0),
+num_unfinished_(0),
+next_queue_(0),
+is_stopping_(false) {
+    if (num_workers <= 0) {
+        num_workers = static_cast<int>(std::thread::hardware_concurrency());
+    }
+
+    if (num_workers <= 0) {
+        num_workers = 1;
+    }
+
+    for (int i = 0; i < num_workers; ++i) {
+        queues_.push_back(new WorkerQueue());
+    }
+
+    for (int i = 0; i < num_workers; ++i) {
+        workers_.push_back(std::thread(&ThreadPool::WorkerLoop, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::unique_lock<std::mutex> lock(state_mutex_);
+        is_stopping_ = true;
+    }
+
+    work_available_.notify_all();
+
+    for (uint i = 0; i < workers_.size(); ++i) {
+        workers_[i].join();
+    }
+
+    for (uint i = 0; i < queues_.size(); ++i) {
+        delete queues_[i];
+    }
+}
+
+void ThreadPool::Submit(Task* task) {
+    WorkerQueue* queue = NULL;
+
+    {
+        std::unique_lock<std::mutex> lock(state_mutex_);
+        queue = queues_[next_queue_];
+        next_queue_ = (next_queue_ + 1) % queues_.size();
+        ++num_unfinished_;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(queue->mutex);
+        queue->tasks.push_back(task);
+    }
+
+    //Only make the task claimable once it actually sits in a queue.
+    {
+        std::unique_lock<std::mutex> lock(state_mutex_);
+        ++num_queued_;
+    }
+
+    work_available_.notify_one();
+}
+
+void ThreadPool::Wait() {
+    std::unique_lock<std::mutex> lock(state_mutex_);
+
+    while (0 != num_unfinished_) {
+        work_finished_.wait(lock);
+    }
+}
+
+void ThreadPool::WorkerLoop(const int worker_id) {
+    while (true) {
+        //Claim one of the queued tasks, or sleep until there is one.
+        {
+            std::unique_lock<std::mutex> lock(state_mutex_);
+
+            while (0 == num_queued_ && !is_stopping_) {
+                work_available_.wait(lock);
+            }
+
+            if (0 == num_queued_) {
+                return;     //Stopping, and nothing left to do.
+            }
+
+            --num_queued_;
+        }
+
+        Task* task = this->TakeTask(worker_id);
+        task->Run(worker_id);
+
+        {
+            std::unique_lock<std::mutex> lock(state_mutex_);
+            --num_unfinished_;
+
+            if (0 == num_unfinished_) {
+                work_finished_.notify_all();
+            }
+        }
+    }
+}
+
+Task* ThreadPool::TakeTask(const int worker_id) {
+    //The caller has claimed a task, so there is at least one in the queues
+    //that no other worker will take.  Keep looking until it is found.
+    const uint num_queues = queues_.size();
+
+    while (true) {
+        //Try the worker's own queue first.
+        {
+            WorkerQueue* queue = queues_[worker_id];
+            std::unique_lock<std::mutex> lock(queue->mutex);
+
+            if (!queue->tasks.empty()) {
+                Task* task = queue->tasks.back();
+                queue->tasks.pop_back();
+                return task;
+            }
+        }
+
+        //Steal from the others, starting with the next worker over.
+        for (uint i = 1; i < num_queues; ++i) {
+            WorkerQueue* queue = queues_[(worker_id + i) % num_queues];
+            std::unique_lock<std::mutex> lock(queue->mutex);
+
+            if (!queue->tasks.empty()) {
+                Task* task = queue->tasks.front();
+                queue->tasks.pop_front();
+                return task;
+            }
+        }
+    }
+}
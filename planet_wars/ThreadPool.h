@@ -0,0 +1,71 @@
+//Available under GPLv3.
+//Author: Iouri Khramtsov.
+
+//A work-stealing thread pool.  Every worker has its own queue of tasks;
+//a worker takes tasks from the back of its own queue, and when it runs
+//out of work it steals from the front of the other workers' queues.
+
+#ifndef PLANET_WARS_THREAD_POOL_H_
+#define PLANET_WARS_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Utils.h"
+
+class Task;
+class ThreadPool;
+
+//A unit of work for the thread pool.  The pool does not take ownership
+//of the tasks.
+class Task {
+public:
+    virtual ~Task() {}
+
+    //worker_id is in [0, ThreadPool::NumWorkers()).
+    virtual void Run(int worker_id) = 0;
+};
+
+class ThreadPool {
+public:
+    //Start the workers.  Use one worker per hardware thread if num_workers is 0.
+    explicit ThreadPool(int num_workers = 0);
+    ~ThreadPool();
+
+    int NumWorkers() const                  {return static_cast<int>(workers_.size());}
+
+    //Queue a task.  Tasks are dealt out to the workers' queues round-robin.
+    void Submit(Task* task);
+
+    //Block until all submitted tasks have been run.
+    void Wait();
+
+private:
+    class WorkerQueue {
+    public:
+        std::mutex mutex;
+        std::deque<Task*> tasks;
+    };
+
+    //Disallow copying.
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    void WorkerLoop(int worker_id);
+    Task* TakeTask(int worker_id);
+
+    std::vector<std::thread> workers_;
+    std::vector<WorkerQueue*> queues_;
+
+    std::mutex state_mutex_;
+    std::condition_variable work_available_;
+    std::condition_variable work_finished_;
+    int num_queued_;        //Tasks sitting in the queues that no worker has claimed yet.
+    int num_unfinished_;    //Tasks submitted but not yet run to completion.
+    uint next_queue_;
+    bool is_stopping_;
+};
+
+#endif
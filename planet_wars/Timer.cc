@@ -1,3 +1,5 @@
+#include <atomic>
+
 #include "Timer.h"
 #include "Utils.h"
 
@@ -9,7 +11,7 @@
 
 const long int SECONDS_PER_DAY = 86400;
 
-#ifndef IS_SUBMISSION
+#if !defined(IS_SUBMISSION) && defined(_WIN32)
     //We're on Windows.
     //Create our own version of gettimeofday().
     #include <time.h>
@@ -64,9 +66,12 @@ const long int SECONDS_PER_DAY = 86400;
 	#include <sys/time.h>
 #endif
 
-//In microseconds
-long int gTimeOut = 0;
-long int gStartTime = 0;
+//In milliseconds.  Each thread has its own timer.
+pw_thread_local long int gTimeOut = 0;
+pw_thread_local long int gStartTime = 0;
+
+//Set by SetStopFlag().  Each thread watches its own flag.
+pw_thread_local const std::atomic<bool>* gStopFlag = NULL;
 
 void SetTimeOut(double seconds) {
 	timeval startTime;
@@ -77,6 +82,10 @@ void SetTimeOut(double seconds) {
 }
 
 bool HasTimedOut() {
+    if (IsStopRequested()) {
+        return true;
+    }
+
 	timeval currentTime;
 	gettimeofday(&currentTime, NULL);
 
@@ -85,6 +94,18 @@ bool HasTimedOut() {
 	return ((currentMilliseconds - gStartTime) > gTimeOut);
 }
 
+void SetStopFlag(const std::atomic<bool>* stop_flag) {
+    gStopFlag = stop_flag;
+}
+
+const std::atomic<bool>* GetStopFlag() {
+    return gStopFlag;
+}
+
+bool IsStopRequested() {
+    return (NULL != gStopFlag && *gStopFlag);
+}
+
 int MillisElapsed() {
 	timeval currentTime;
 	gettimeofday(&currentTime, NULL);
@@ -93,3 +114,13 @@ int MillisElapsed() {
     const long int millisElapsed = (currentMilliseconds - gStartTime);
     return millisElapsed;
 }
+
+void GetTimer(long int* start_time, long int* time_out) {
+    *start_time = gStartTime;
+    *time_out = gTimeOut;
+}
+
+void SetTimer(long int start_time, long int time_out) {
+    gStartTime = start_time;
+    gTimeOut = time_out;
+}
@@ -9,6 +9,8 @@ The timer does not use any signals, and will not notify of the timeout.
 #ifndef PLANET_WARS_TIMER_H_
 #define PLANET_WARS_TIMER_H_
 
+#include <atomic>
+
 /*
 Set the timeout for the timer and start the timer.  
 Example: SetTimeOut(0.995) sets the timer for 995ms
@@ -20,11 +22,31 @@ Check whether the timer has run out.
 */
 bool HasTimedOut();
 
+/*
+Make HasTimedOut() on the calling thread also return true once the given
+flag is set.  Pass NULL to stop watching a flag.
+*/
+void SetStopFlag(const std::atomic<bool>* stop_flag);
+const std::atomic<bool>* GetStopFlag();
+
+/*
+Check whether the flag given to SetStopFlag() is set, without looking at the timer.
+*/
+bool IsStopRequested();
+
 /*
 Get the number of milliseconds since the last call to SetTimeOut()
 */
 int MillisElapsed();
 
+/*
+Each thread has its own timer.  These get and set the timer's start
+time and timeout in milliseconds, so that a thread can share another
+thread's deadline.
+*/
+void GetTimer(long int* start_time, long int* time_out);
+void SetTimer(long int start_time, long int time_out);
+
 #ifndef NULL
 #define NULL 0
 #endif
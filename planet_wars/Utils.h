@@ -11,6 +11,13 @@
 #define ENEMY_RESERVES_SHIPS_AGAINST_ARRIVALS
 //#define MAKE_ENEMY_MOVES_ON_FIRST_TURN
 //#define USE_SEPARATE_SUPPORT_PLANS
+#define WITH_PARALLEL_SEARCH
+#define PRUNE_BY_RETURN_BOUND
+#define WITH_ANYTIME_SEARCH
+#define WITH_WATCHDOG
+#define WITH_PONDERING
+#define WITH_SIMD_BALANCES
+//#define WITH_FULL_TIMELINE_CHECKS
 
 //Switch between test environment and contest environment.
 //#define IS_SUBMISSION
@@ -24,6 +31,16 @@
         #define WITH_TIMEOUTS
     #endif
 
+    //The contest servers give each bot a single core.
+    #ifdef WITH_PARALLEL_SEARCH
+        #undef WITH_PARALLEL_SEARCH
+    #endif
+
+    //Pondering needs a core of its own too.
+    #ifdef WITH_PONDERING
+        #undef WITH_PONDERING
+    #endif
+
 #else
 
     #include <assert.h>
@@ -36,10 +53,20 @@
     typedef unsigned int uint;
 #endif
 
+typedef unsigned long long uint64;
+
 #ifndef NULL
     #define NULL 0
 #endif
 
+//Per-thread storage for globals that must not be shared between threads
+//that play separate games.
+#if defined(_MSC_VER)
+    #define pw_thread_local __declspec(thread)
+#else
+    #define pw_thread_local __thread
+#endif
+
 //Useful functions
 void forceCrash();
 
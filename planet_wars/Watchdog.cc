@@ -0,0 +1,101 @@
+//Available under GPLv3.
+//Author: Iouri Khramtsov.
+
+//A watchdog that makes sure that the orders for a turn are sent in time.
+
+#include <iostream>
+#include <sstream>
+#include "Watchdog.h"
+
+/************************************************
+               Watchdog class
+************************************************/
+Watchdog::Watchdog()
+: is_turn_active_(false),
+is_stopping_(false),
+is_timed_out_(false) {
+    thread_ = std::thread(&Watchdog::WatchLoop, this);
+}
+
+Watchdog::~Watchdog() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        is_stopping_ = true;
+    }
+
+    turn_changed_.notify_all();
+    thread_.join();
+}
+
+void Watchdog::StartTurn(const double seconds) {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        deadline_ = std::chrono::steady_clock::now()
+            + std::chrono::milliseconds(static_cast<long int>(seconds * 1000.0));
+        published_orders_.clear();
+        is_turn_active_ = true;
+        is_timed_out_ = false;
+    }
+
+    turn_changed_.notify_all();
+}
+
+void Watchdog::Publish(const ActionList& actions) {
+    const std::string orders = OrdersFor(actions);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    published_orders_ = orders;
+}
+
+bool Watchdog::FinishTurn(const ActionList& actions) {
+    const std::string orders = OrdersFor(actions);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        if (!is_turn_active_) {
+            return false;   //Too late; the published orders went out instead.
+        }
+
+        SendOrders(orders);
+        is_turn_active_ = false;
+    }
+
+    turn_changed_.notify_all();
+    return true;
+}
+
+void Watchdog::WatchLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (!is_stopping_) {
+        if (!is_turn_active_) {
+            turn_changed_.wait(lock);
+            continue;
+        }
+
+        turn_changed_.wait_until(lock, deadline_);
+
+        if (is_turn_active_ && !is_stopping_ && std::chrono::steady_clock::now() >= deadline_) {
+            //Out of time.  Send what we have, and stop the search.
+            SendOrders(published_orders_);
+            is_turn_active_ = false;
+            is_timed_out_ = true;
+        }
+    }
+}
+
+std::string Watchdog::OrdersFor(const ActionList& actions) {
+    std::stringstream orders;
+
+    for (uint i = 0; i < actions.size(); ++i) {
+        orders << actions[i]->ToMoveOrder();
+    }
+
+    return orders.str();
+}
+
+void Watchdog::SendOrders(const std::string& orders) {
+    std::cout << orders << "go" << std::endl;
+    std::cout.flush();
+}
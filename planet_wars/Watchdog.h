@@ -0,0 +1,64 @@
+//Available under GPLv3.
+//Author: Iouri Khramtsov.
+
+//A watchdog that makes sure that the orders for a turn are sent in time.
+//The bot publishes the orders it has settled on as it goes.  If the turn's
+//deadline passes before the bot finishes, the watchdog sends the published
+//orders and "go" on its own thread, and sets its time-out flag.  The main
+//search watches the flag through SetStopFlag(), so that it winds down.
+
+#ifndef PLANET_WARS_WATCHDOG_H_
+#define PLANET_WARS_WATCHDOG_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "Actions.h"
+#include "Utils.h"
+
+class Watchdog {
+public:
+    Watchdog();
+    ~Watchdog();
+
+    //Start watching a turn that must be finished within the given number of seconds.
+    void StartTurn(double seconds);
+
+    //Replace the orders to be sent if the turn runs out of time.  Only the
+    //actions departing now are sent.
+    void Publish(const ActionList& actions);
+
+    //Send the final orders for the turn.  Return false if the watchdog has
+    //already sent the published orders instead.
+    bool FinishTurn(const ActionList& actions);
+
+    //Set once the watchdog has sent the published orders for the current
+    //turn, and cleared when the next turn starts.
+    const std::atomic<bool>* TimeOutFlag() const   {return &is_timed_out_;}
+
+private:
+    //Disallow copying.
+    Watchdog(const Watchdog&);
+    Watchdog& operator=(const Watchdog&);
+
+    void WatchLoop();
+
+    static std::string OrdersFor(const ActionList& actions);
+
+    //Write the orders and "go" to the game engine.
+    static void SendOrders(const std::string& orders);
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable turn_changed_;
+    std::chrono::steady_clock::time_point deadline_;
+    std::string published_orders_;
+    bool is_turn_active_;
+    bool is_stopping_;
+    std::atomic<bool> is_timed_out_;
+};
+
+#endif